@@ -0,0 +1,87 @@
+#include <stb_image_aug.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// JPEG ׼ÿͼֱôC IDCT/YCbCrת/2x2ɫϲ  SIMD 汾stbi_install_jpeg_simd
+// ڴɴΣÿͼ MB/sRGBAֽ㣩ֽڱȽߵвһʱ1
+// һΪ stb_image_aug.c  GLtest  stb_image.cpp ͬ stbi_* ӵһ
+// ÷JpegBench [ͼĿ¼] [ÿͼ]
+
+static bool readFile(const std::string& path, std::vector<unsigned char>& bytes) {
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	if (!in)
+		return false;
+	std::streamoff size = in.tellg();
+	if (size <= 0)
+		return false;
+	bytes.resize((size_t)size);
+	in.seekg(0);
+	return (bool)in.read((char*)bytes.data(), size);
+}
+
+//  repeat ΣһεĽ pixels ʧܷظ
+static double decode(const std::vector<unsigned char>& file, int repeat, std::vector<unsigned char>& pixels, int& width, int& height) {
+	double seconds = 0.0;
+	for (int i = 0; i < repeat; i++) {
+		int channels;
+		auto start = std::chrono::steady_clock::now();
+		unsigned char* data = stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &channels, 4);
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (!data)
+			return -1.0;
+		pixels.assign(data, data + (size_t)width * height * 4);
+		stbi_image_free(data);
+	}
+	return seconds;
+}
+
+int main(int argc, char* argv[]) {
+	std::string directory = argc > 1 ? argv[1] : "D:/Visual Studio/Project/GLstudy/src/source/textures";
+	int repeat = argc > 2 ? (std::max)(std::atoi(argv[2]), 1) : 10;
+	const char* files[] = { "skybox/right.jpg", "skybox/left.jpg", "skybox/top.jpg", "skybox/bottom.jpg", "skybox/front.jpg",
+		"skybox/back.jpg", "bricks2.jpg", "bricks2_normal.jpg", "bricks2_disp.jpg", "brickwall.jpg", "marble.jpg", "container.jpg" };
+
+	if (!stbi_install_jpeg_simd(1))
+		std::cout << "ûбSIMD汾Ҫ SSE2жǴC" << std::endl;
+
+	int mismatches = 0;
+	double megabytes = 0.0, scalarSeconds = 0.0, simdSeconds = 0.0;
+	for (const char* file : files) {
+		std::vector<unsigned char> bytes;
+		if (!readFile(directory + "/" + file, bytes))
+			continue;
+		std::vector<unsigned char> scalar, simd;
+		int width = 0, height = 0;
+		stbi_install_jpeg_simd(0);
+		double scalarTime = decode(bytes, repeat, scalar, width, height);
+		stbi_install_jpeg_simd(1);
+		double simdTime = decode(bytes, repeat, simd, width, height);
+		if (scalarTime < 0.0 || simdTime < 0.0) {
+			std::cout << "ERROR::JPEG::" << file << " ʧ: " << stbi_failure_reason() << std::endl;
+			mismatches++;
+			continue;
+		}
+
+		double mb = (double)width * height * 4 * repeat / 1.0e6;
+		megabytes += mb;
+		scalarSeconds += scalarTime;
+		simdSeconds += simdTime;
+		bool same = scalar == simd;
+		mismatches += same ? 0 : 1;
+		std::cout << file << " " << width << "x" << height << "  C: " << mb / scalarTime << "  SIMD: " << mb / simdTime
+			<< " MB/s  x" << scalarTime / simdTime << (same ? "" : " һ!") << std::endl;
+	}
+	if (megabytes == 0.0) {
+		std::cout << "ERROR::JPEG:: " << directory << " ûҵͼ" << std::endl;
+		return 1;
+	}
+	std::cout << "ϼ C: " << megabytes / scalarSeconds << "  SIMD: " << megabytes / simdSeconds << " MB/s" << std::endl;
+	std::cout << (mismatches ? "SIMD봿Cһ" : "SIMD봿Cһ") << std::endl;
+	return mismatches ? 1 : 0;
+}
@@ -2,6 +2,10 @@
 #include <vector>
 #include <direct.h>
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
 #include <windows.h>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -11,6 +15,14 @@
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <learnopengl/render_targets.h>
+#include <learnopengl/dynamic_resolution.h>
+#include <learnopengl/profiler.h>
+// --benchmark ʱͳÿ֡Ķѷ滻ȫ operator new/deleteֻһ뵥Ԫﶨ壩
+#define BENCHMARK_COUNT_ALLOCATIONS
+#include <learnopengl/benchmark.h>
+#include <learnopengl/frustum.h>
+#include <learnopengl/bvh.h>
 
 // ɫ
 const char* vertexShaderSource = R"glsl(
@@ -36,6 +48,32 @@ void main()
 }
 )glsl";
 
+// ʵĶɫģ;ɫʵ
+const char* instancedVertexShaderSource = R"glsl(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in mat4 aModel;   // ռ 1~4
+layout (location = 5) in vec3 aColor;
+out vec3 Color;
+uniform mat4 view;
+uniform mat4 projection;
+void main()
+{
+    Color = aColor;
+    gl_Position = projection * view * aModel * vec4(aPos, 1.0);
+}
+)glsl";
+
+const char* instancedFragmentShaderSource = R"glsl(
+#version 330 core
+out vec4 FragColor;
+in vec3 Color;
+void main()
+{
+    FragColor = vec4(Color, 1.0);
+}
+)glsl";
+
 // ĻȾɫ
 const char* screenVertexShaderSource = R"glsl(
 #version 330 core
@@ -61,11 +99,44 @@ uniform sampler2D scene;
 uniform sampler2D bloomBlur;
 uniform bool bloom;
 uniform float exposure;
+uniform bool upscale;   // ԵڴڵķֱȾʱΪtrue
+
+// Catmull-Rom ˫β˫Թֻ9βŴʱֱ˫Ը
+vec3 sampleCatmullRom(sampler2D image, vec2 uv)
+{
+    vec2 texSize = vec2(textureSize(image, 0));
+    vec2 samplePos = uv * texSize;
+    vec2 texPos1 = floor(samplePos - 0.5) + 0.5;
+    vec2 f = samplePos - texPos1;
+
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+
+    // мȨغϲһ˫Բ
+    vec2 w12 = w1 + w2;
+    vec2 texPos0 = (texPos1 - 1.0) / texSize;
+    vec2 texPos3 = (texPos1 + 2.0) / texSize;
+    vec2 texPos12 = (texPos1 + w2 / w12) / texSize;
+
+    vec3 result = texture(image, vec2(texPos0.x, texPos0.y)).rgb * w0.x * w0.y;
+    result += texture(image, vec2(texPos12.x, texPos0.y)).rgb * w12.x * w0.y;
+    result += texture(image, vec2(texPos3.x, texPos0.y)).rgb * w3.x * w0.y;
+    result += texture(image, vec2(texPos0.x, texPos12.y)).rgb * w0.x * w12.y;
+    result += texture(image, vec2(texPos12.x, texPos12.y)).rgb * w12.x * w12.y;
+    result += texture(image, vec2(texPos3.x, texPos12.y)).rgb * w3.x * w12.y;
+    result += texture(image, vec2(texPos0.x, texPos3.y)).rgb * w0.x * w3.y;
+    result += texture(image, vec2(texPos12.x, texPos3.y)).rgb * w12.x * w3.y;
+    result += texture(image, vec2(texPos3.x, texPos3.y)).rgb * w3.x * w3.y;
+    // ԰ڸ߶ԱȶȱԵֵܲ
+    return max(result, vec3(0.0));
+}
 
 void main()
 {
     const float gamma = 2.2;
-    vec3 hdrColor = texture(scene, TexCoords).rgb;      
+    vec3 hdrColor = upscale ? sampleCatmullRom(scene, TexCoords) : texture(scene, TexCoords).rgb;
     vec3 bloomColor = texture(bloomBlur, TexCoords).rgb;
     
     // ˷⣬ӷЧ
@@ -109,7 +180,7 @@ void main()
         for(int i = 1; i < 5; ++i)
         {
             result += texture(image, TexCoords + vec2(0.0, tex_offset.y * i)).rgb * weight[i];
-            result += texture(image, TexCoords - vec2(.0, tex_offset.y * i)).rgb * weight[i];
+            result += texture(image, TexCoords - vec2(0.0, tex_offset.y * i)).rgb * weight[i];
         }
     }
     FragColor = vec4(result, 1.0);
@@ -138,6 +209,65 @@ void main()
 }
 )glsl";
 
+// ˫Kawase⣺ÿȡĺĸԽǵ˫Բ
+// һͬʱֵȡʡĸ߹ȡpass
+const char* kawaseDownFragmentShaderSource = R"glsl(
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D image;
+uniform vec2 halfPixel;   // ĿصС
+uniform bool prefilter;   // Ƿֵ
+
+vec3 fetch(vec2 uv)
+{
+    vec3 color = texture(image, uv).rgb;
+    if(prefilter)
+    {
+        float brightness = dot(color, vec3(0.2126, 0.7152, 0.0722));
+        if(brightness <= 1.0)
+            color = vec3(0.0);
+    }
+    return color;
+}
+
+void main()
+{
+    vec3 sum = fetch(TexCoords) * 4.0;
+    sum += fetch(TexCoords - halfPixel);
+    sum += fetch(TexCoords + halfPixel);
+    sum += fetch(TexCoords + vec2(halfPixel.x, -halfPixel.y));
+    sum += fetch(TexCoords - vec2(halfPixel.x, -halfPixel.y));
+    FragColor = vec4(sum / 8.0, 1.0);
+}
+)glsl";
+
+// ˫Kawase⣺8β˲𼶷Ŵذֱ
+const char* kawaseUpFragmentShaderSource = R"glsl(
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D image;
+uniform vec2 halfPixel;   // ĿصС
+
+void main()
+{
+    vec3 sum = texture(image, TexCoords + vec2(-halfPixel.x * 2.0, 0.0)).rgb;
+    sum += texture(image, TexCoords + vec2(-halfPixel.x, halfPixel.y)).rgb * 2.0;
+    sum += texture(image, TexCoords + vec2(0.0, halfPixel.y * 2.0)).rgb;
+    sum += texture(image, TexCoords + vec2(halfPixel.x, halfPixel.y)).rgb * 2.0;
+    sum += texture(image, TexCoords + vec2(halfPixel.x * 2.0, 0.0)).rgb;
+    sum += texture(image, TexCoords + vec2(halfPixel.x, -halfPixel.y)).rgb * 2.0;
+    sum += texture(image, TexCoords + vec2(0.0, -halfPixel.y * 2.0)).rgb;
+    sum += texture(image, TexCoords + vec2(-halfPixel.x, -halfPixel.y)).rgb * 2.0;
+    FragColor = vec4(sum / 12.0, 1.0);
+}
+)glsl";
+
 // PBRɫ
 const char* pbrVertexShaderSource = R"glsl(
 #version 330 core
@@ -150,13 +280,14 @@ out vec3 Normal;
 out vec2 TexCoords;
 
 uniform mat4 model;
+uniform mat3 normalMatrix;  // transpose(inverse(mat3(model)))ÿCPUһ
 uniform mat4 view;
 uniform mat4 projection;
 
 void main()
 {
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+    Normal = normalMatrix * aNormal;
     TexCoords = aTexCoords;
     gl_Position = projection * view * model * vec4(aPos, 1.0);
 }
@@ -177,13 +308,31 @@ uniform float metallic;
 uniform float roughness;
 uniform float ao;
 
-// ղ
-uniform vec3 lightPositions[4];
-uniform vec3 lightColors[4];
+// ղִعգÿ(Ļ x Ƭ)ֻཻĹԴ LightClusters д
+uniform samplerBuffer lightData;      // ÿԴtexelλ+뾶ɫ
+uniform usamplerBuffer clusterData;   // ÿأԴʼλã
+uniform usamplerBuffer lightIndices;
+uniform ivec3 clusterTiles;
+uniform vec2 clusterTileSize;
+uniform float clusterScale;
+uniform float clusterBias;
+uniform float clusterNear;
+uniform float clusterFar;
 uniform vec3 viewPos;
 
 const float PI = 3.14159265359;
 
+uvec2 fragmentCluster()
+{
+    // ȻֵԭΪ۲ռȣֲٰƬ
+    float ndcZ = gl_FragCoord.z * 2.0 - 1.0;
+    float depth = 2.0 * clusterNear * clusterFar / (clusterFar + clusterNear - ndcZ * (clusterFar - clusterNear));
+    int slice = clamp(int(floor(log(depth) * clusterScale + clusterBias)), 0, clusterTiles.z - 1);
+    ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterTileSize), clusterTiles.xy - 1);
+    int index = tile.x + tile.y * clusterTiles.x + slice * clusterTiles.x * clusterTiles.y;
+    return texelFetch(clusterData, index).xy;
+}
+
 float DistributionGGX(vec3 N, vec3 H, float roughness)
 {
     float a = roughness*roughness;
@@ -235,14 +384,22 @@ void main()
 
     // ䷽
     vec3 Lo = vec3(0.0);
-    for(int i = 0; i < 4; ++i) 
+    uvec2 cluster = fragmentCluster();
+    for(uint i = 0u; i < cluster.y; ++i) 
     {
         // ÿԴ
-        vec3 L = normalize(lightPositions[i] - FragPos);
+        int light = int(texelFetch(lightIndices, int(cluster.x + i)).r);
+        vec4 positionRadius = texelFetch(lightData, light * 2);
+        vec3 lightColor = texelFetch(lightData, light * 2 + 1).rgb;
+        float distance = length(positionRadius.xyz - FragPos);
+        if (distance >= positionRadius.w)
+            continue;
+        vec3 L = normalize(positionRadius.xyz - FragPos);
         vec3 H = normalize(V + L);
-        float distance = length(lightPositions[i] - FragPos);
-        float attenuation = 1.0 / (distance * distance);
-        vec3 radiance = lightColors[i] * attenuation;
+        // ƽ˥ԴںڹԴ뾶ƽ˥0
+        float window = clamp(1.0 - pow(distance / positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (distance * distance);
+        vec3 radiance = lightColor * attenuation;
 
         // Cook-Torrance BRDF
         float NDF = DistributionGGX(N, H, roughness);   
@@ -360,16 +517,228 @@ float lastY = 300.0f;
 bool firstMouse = true;
 float fov = 45.0f;
 
+// ֡ʵʴСDPIĻϿܴڴڴС framebuffer_size_callback 
+int framebufferWidth = 800;
+int framebufferHeight = 600;
+
 // ֡ʱ
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
+// ߳ʵ = ߳ * ߳PageUp/PageDown лڲʵչ
+const int cubeGridSizes[] = { 6, 16, 32, 100, 316, 1000 };  // 36 ~ 1M ʵ
+int cubeGridLevel = 0;
+
+// ׶޳ģͺʵύGLǰȺ׶󽻣CԱԱ
+bool frustumCullingEnabled = true;
+
+// ʵ֣true Ϊ˫Kawase/false Ϊԭȫֱʸ˹ping-pongKлԱԱ
+bool kawaseBloom = true;
+// KawaseĲ800x600 ʱΪ 400x300 ... 25x18
+const int BLOOM_MIPS = 5;
+
+// ֱ̬ʣݳͷGPUʱȾֱʣR
+bool dynamicResolutionEnabled = true;
+// +GPUʱԤ㣬60Hz¸ϳɺͽ
+const float RENDER_BUDGET_MS = 10.0f;
+
+// Pʼ/ֹͣÿ֡passCPU/GPUʱдChrome traceļ
+bool traceToggleRequested = false;
+const unsigned int TRACE_MAX_FRAMES = 1000;
+
+// ʰȡĻģ׼ǣ壬Ⱦѭд
+bool pickRequested = false;
+
+// ÿʵ
+struct CubeInstance {
+    glm::mat4 model;
+    glm::vec4 color;   // ֻ rgb뵽 16 ֽ
+};
+
+// ʵ塣֧ GL 4.4 ʱʹó־ӳλλ壬ÿ fence 
+// ÿ֡orphanϴ
+const int INSTANCE_BUFFER_SEGMENTS = 3;
+struct InstanceBuffer {
+    unsigned int VBO = 0;
+    size_t capacity = 0;                  // ÿοɵʵ
+    bool persistent = false;
+    bool allowPersistent = true;          // ȴ fence ʧܺùϴ
+    CubeInstance* mapped = nullptr;       // ־ӳʼַ
+    std::vector<CubeInstance> staging;    // ǳ־ӳʱ CPU 
+    GLsync fences[INSTANCE_BUFFER_SEGMENTS] = {};
+    unsigned int segment = 0;
+};
+
+// ʵָ룬offset Ϊ֡ڻеֽƫ
+void setInstanceAttributes(unsigned int vao, const InstanceBuffer& buffer, size_t offset)
+{
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+    for (int c = 0; c < 4; c++) {
+        glVertexAttribPointer(1 + c, 4, GL_FLOAT, GL_FALSE, sizeof(CubeInstance),
+            (void*)(offset + offsetof(CubeInstance, model) + c * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(1 + c);
+        glVertexAttribDivisor(1 + c, 1);
+    }
+    glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(CubeInstance), (void*)(offset + offsetof(CubeInstance, color)));
+    glEnableVertexAttribArray(5);
+    glVertexAttribDivisor(5, 1);
+}
+
+// £ capacity ʵĻ
+void createInstanceBuffer(InstanceBuffer& buffer, size_t capacity)
+{
+    if (buffer.VBO) {
+        if (buffer.persistent) {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        for (GLsync& fence : buffer.fences) {
+            if (fence)
+                glDeleteSync(fence);
+            fence = nullptr;
+        }
+        glDeleteBuffers(1, &buffer.VBO);
+    }
+
+    buffer.capacity = capacity;
+    buffer.segment = 0;
+    buffer.mapped = nullptr;
+    buffer.persistent = buffer.allowPersistent && GLAD_GL_VERSION_4_4 && glBufferStorage;
+    glGenBuffers(1, &buffer.VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+
+    if (buffer.persistent) {
+        GLsizeiptr size = (GLsizeiptr)(capacity * sizeof(CubeInstance) * INSTANCE_BUFFER_SEGMENTS);
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+        buffer.mapped = (CubeInstance*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        buffer.persistent = buffer.mapped != nullptr;
+        buffer.staging.clear();
+        buffer.staging.shrink_to_fit();
+    }
+    if (!buffer.persistent) {
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(CubeInstance), NULL, GL_STREAM_DRAW);
+        buffer.staging.resize(capacity);
+    }
+}
+
+// ر֡дʵݣҪʱȴ GPU ö
+CubeInstance* beginInstanceWrite(InstanceBuffer& buffer)
+{
+    if (!buffer.persistent)
+        return buffer.staging.data();
+
+    GLsync& fence = buffer.fences[buffer.segment];
+    if (fence) {
+        // ʱ GPU ΣȾһ֡ܳ1룩һֱȵ fence Ϊֹ
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        while (result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(fence, 0, 1000000000);
+        if (result == GL_WAIT_FAILED) {
+            // ޷ȷ GPU Ƿڶݣ־ӳ䣬ؽΪÿ֡ϴĻ
+            std::cout << "WARNING::INSTANCES:: glClientWaitSync failed, falling back to orphaning" << std::endl;
+            buffer.allowPersistent = false;
+            createInstanceBuffer(buffer, buffer.capacity);
+            return buffer.staging.data();
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    return buffer.mapped + buffer.segment * buffer.capacity;
+}
+
+// ύ֡д count ʵʵָ
+void endInstanceWrite(InstanceBuffer& buffer, unsigned int vao, size_t count)
+{
+    size_t offset = 0;
+    if (buffer.persistent) {
+        offset = buffer.segment * buffer.capacity * sizeof(CubeInstance);
+    }
+    else {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+        glBufferData(GL_ARRAY_BUFFER, buffer.capacity * sizeof(CubeInstance), NULL, GL_STREAM_DRAW);  // ݣͬȴ
+        glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(CubeInstance), buffer.staging.data());
+    }
+    setInstanceAttributes(vao, buffer, offset);
+}
+
+// ʹñݵĻ֮ fenceлһ
+void fenceInstanceWrite(InstanceBuffer& buffer)
+{
+    if (!buffer.persistent)
+        return;
+    buffer.fences[buffer.segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    buffer.segment = (buffer.segment + 1) % INSTANCE_BUFFER_SEGMENTS;
+}
+
+// GL_TIME_ELAPSED ʱѯʹãȡһ֡ĽCPUȴGPU
+struct GpuTimer {
+    unsigned int queries[2] = { 0, 0 };
+    int current = 0;
+    int issued = 0;
+};
+
+void createGpuTimer(GpuTimer& timer)
+{
+    glGenQueries(2, timer.queries);
+}
+
+void beginGpuTimer(GpuTimer& timer)
+{
+    glBeginQuery(GL_TIME_ELAPSED, timer.queries[timer.current]);
+}
+
+// ֡ļʱȡһ֡Ľ룩û׼ʱfalse
+bool endGpuTimer(GpuTimer& timer, double& ms)
+{
+    glEndQuery(GL_TIME_ELAPSED);
+    timer.current = 1 - timer.current;
+    if (++timer.issued < 2)
+        return false;
+
+    GLint ready = 0;
+    glGetQueryObjectiv(timer.queries[timer.current], GL_QUERY_RESULT_AVAILABLE, &ready);
+    if (!ready)
+        return false;
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(timer.queries[timer.current], GL_QUERY_RESULT, &ns);
+    ms = ns / 1.0e6;
+    return true;
+}
+
 struct Mesh {
     std::vector<float> vertices;
-    unsigned int VAO, VBO;
+    std::vector<unsigned int> indices;  // Ϊʱ߷·glDrawArrays
+    unsigned int VAO, VBO, EBO = 0;
+    BoundingVolume bounds;              // ģͿռİΧкͰΧ򣬼ʱ
+    Bvh bvh;                            // ģͿռBVHʰȡ
 };
 
-bool loadModel(const std::string& path, Mesh& mesh) {
+// λȽϵĶλüںͬλõĶ
+struct PositionKey {
+    float x, y, z;
+    bool operator==(const PositionKey& other) const {
+        return std::memcmp(this, &other, sizeof(PositionKey)) == 0;
+    }
+};
+
+struct PositionKeyHash {
+    size_t operator()(const PositionKey& key) const {
+        uint32_t bits[3];
+        std::memcpy(bits, &key, sizeof(bits));
+        size_t h = bits[0];
+        h = h * 0x9E3779B1u ^ bits[1];
+        h = h * 0x9E3779B1u ^ bits[2];
+        return h;
+    }
+};
+
+// indexed Ϊ true ʱͬλõĶ㣬ϴ EBO  glDrawElements ƣ
+// Ϊ false ʱԭչʽڶԱ VBO Сͼغʱ
+bool loadModel(const std::string& path, Mesh& mesh, bool indexed = true) {
+    auto loadStart = std::chrono::steady_clock::now();
+
     Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile(
         path,
@@ -381,19 +750,69 @@ bool loadModel(const std::string& path, Mesh& mesh) {
         return false;
     }
 
-    // 
+    // Ԥͳ push_back 
+    size_t totalVertices = 0, totalCorners = 0;
     for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
-        aiMesh* aiMesh = scene->mMeshes[i];
-        for (unsigned int j = 0; j < aiMesh->mNumFaces; j++) {
-            aiFace face = aiMesh->mFaces[j];
-            for (unsigned int k = 0; k < face.mNumIndices; k++) {
-                unsigned int index = face.mIndices[k];
-                mesh.vertices.push_back(aiMesh->mVertices[index].x);
-                mesh.vertices.push_back(aiMesh->mVertices[index].y);
-                mesh.vertices.push_back(aiMesh->mVertices[index].z);
+        totalVertices += scene->mMeshes[i]->mNumVertices;
+        totalCorners += scene->mMeshes[i]->mNumFaces * 3;  // ǻ
+    }
+
+    if (indexed) {
+        mesh.vertices.reserve(totalVertices * 3);
+        mesh.indices.reserve(totalCorners);
+        std::unordered_map<PositionKey, unsigned int, PositionKeyHash> welded;
+        welded.reserve(totalVertices);
+
+        // ֻλãͬλõĶԺϲ
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+            aiMesh* aiMesh = scene->mMeshes[i];
+            std::vector<unsigned int> remap(aiMesh->mNumVertices);
+            for (unsigned int v = 0; v < aiMesh->mNumVertices; v++) {
+                PositionKey key = { aiMesh->mVertices[v].x, aiMesh->mVertices[v].y, aiMesh->mVertices[v].z };
+                auto it = welded.emplace(key, (unsigned int)(mesh.vertices.size() / 3));
+                if (it.second) {
+                    mesh.vertices.push_back(key.x);
+                    mesh.vertices.push_back(key.y);
+                    mesh.vertices.push_back(key.z);
+                }
+                remap[v] = it.first->second;
+            }
+            for (unsigned int j = 0; j < aiMesh->mNumFaces; j++) {
+                const aiFace& face = aiMesh->mFaces[j];
+                for (unsigned int k = 0; k < face.mNumIndices; k++)
+                    mesh.indices.push_back(remap[face.mIndices[k]]);
             }
         }
     }
+    else {
+        mesh.vertices.reserve(totalCorners * 3);
+
+        // 
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+            aiMesh* aiMesh = scene->mMeshes[i];
+            for (unsigned int j = 0; j < aiMesh->mNumFaces; j++) {
+                const aiFace& face = aiMesh->mFaces[j];
+                for (unsigned int k = 0; k < face.mNumIndices; k++) {
+                    unsigned int index = face.mIndices[k];
+                    mesh.vertices.push_back(aiMesh->mVertices[index].x);
+                    mesh.vertices.push_back(aiMesh->mVertices[index].y);
+                    mesh.vertices.push_back(aiMesh->mVertices[index].z);
+                }
+            }
+        }
+    }
+
+    mesh.bounds = ComputeBounds(mesh.vertices.data(), mesh.vertices.size() / 3, 3 * sizeof(float));
+
+    // μBVHչģʽ¶㱾ͰУ˳
+    std::vector<unsigned int> sequential;
+    if (mesh.indices.empty()) {
+        sequential.resize(mesh.vertices.size() / 3);
+        for (size_t v = 0; v < sequential.size(); v++)
+            sequential[v] = (unsigned int)v;
+    }
+    const std::vector<unsigned int>& corners = mesh.indices.empty() ? sequential : mesh.indices;
+    mesh.bvh.build(TriangleBounds(mesh.vertices.data(), 3 * sizeof(float), corners.data(), corners.size()));
 
     //  VAO/VBO
     glGenVertexArrays(1, &mesh.VAO);
@@ -403,15 +822,126 @@ bool loadModel(const std::string& path, Mesh& mesh) {
     glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
     glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), mesh.vertices.data(), GL_STATIC_DRAW);
 
+    if (!mesh.indices.empty()) {
+        glGenBuffers(1, &mesh.EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+    }
+
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
+    glBindVertexArray(0);
+
+    //  VBO/EBO СͼغʱڱȽģʽ
+    double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+    std::cout << "ģ " << path << (indexed ? " []" : " [չ]")
+        << " : " << mesh.vertices.size() / 3
+        << " VBO: " << mesh.vertices.size() * sizeof(float) << " ֽ"
+        << " EBO: " << mesh.indices.size() * sizeof(unsigned int) << " ֽ"
+        << " ʱ: " << loadMs << " ms" << std::endl;
+
     return true;
 }
 
+// е (i, j) λ
+glm::vec3 cubeGridPosition(int i, int j)
+{
+    // ޸λãʹ3Dռзֲ
+    return glm::vec3(
+        i * 2.0f - 5.0f,  // x: -55
+        j * 1.5f - 4.0f,  // y: -44
+        (i + j) * -1.5f   // z: ȱ仯
+    );
+}
+
+//  (i, j)  time ʱ̵ģ;
+glm::mat4 cubeModelMatrix(int i, int j, float time)
+{
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, cubeGridPosition(i, j));
+    // һЩתʹ忴
+    model = glm::rotate(model, time * glm::radians(20.0f * (i + j)),
+        glm::vec3(0.5f, 1.0f, 0.0f));
+    return model;
+}
+
+// ģ󽻣ģͿռ䣩ľ룬δʱ FLT_MAX
+// 򲻹һԾͱ任ǰռһ
+float raycastMesh(const Mesh& mesh, const Ray& ray)
+{
+    float t;
+    uint32_t hit = mesh.bvh.raycast(ray, [&](uint32_t triangle, const Ray& r, float, float& tHit) {
+        glm::vec3 corners[3];
+        for (int k = 0; k < 3; k++) {
+            size_t v = mesh.indices.empty() ? triangle * 3 + k : mesh.indices[triangle * 3 + k];
+            corners[k] = glm::vec3(mesh.vertices[v * 3], mesh.vertices[v * 3 + 1], mesh.vertices[v * 3 + 2]);
+        }
+        return IntersectRayTriangle(r, corners[0], corners[1], corners[2], tHit);
+    }, t);
+    return hit == UINT32_MAX ? FLT_MAX : t;
+}
+
+// 弶BVHСıʱİΧнһΣת
+// ʰȡǰõǰʱתİΧ refit˲
+void buildCubeBvh(Bvh& bvh, std::vector<Aabb>& boxes, int gridSize)
+{
+    boxes.resize((size_t)gridSize * gridSize);
+    for (int i = 0; i < gridSize; ++i)
+        for (int j = 0; j < gridSize; ++j) {
+            glm::vec3 center = cubeGridPosition(i, j);
+            boxes[(size_t)i * gridSize + j].min = center - glm::vec3(0.8660254f);
+            boxes[(size_t)i * gridSize + j].max = center + glm::vec3(0.8660254f);
+        }
+    bvh.build(boxes);
+}
+
+// еţδз -1
+int pickCube(Bvh& bvh, std::vector<Aabb>& boxes, int gridSize, float time, const Ray& ray, float& hitT)
+{
+    for (int i = 0; i < gridSize; ++i)
+        for (int j = 0; j < gridSize; ++j)
+            boxes[(size_t)i * gridSize + j] = TransformBox(cubeModelMatrix(i, j, time), glm::vec3(0.0f), glm::vec3(0.5f));
+    bvh.refit(boxes);
+
+    // ҶȷOBBԣ߱任ľֲռ [-0.5, 0.5] 
+    uint32_t hit = bvh.raycast(ray, [&](uint32_t cube, const Ray& r, float maxT, float& tHit) {
+        glm::mat4 inverse = glm::inverse(cubeModelMatrix((int)(cube / gridSize), (int)(cube % gridSize), time));
+        Ray local;
+        local.origin = glm::vec3(inverse * glm::vec4(r.origin, 1.0f));
+        local.direction = glm::vec3(inverse * glm::vec4(r.direction, 0.0f));
+        return IntersectRayBox(local, 1.0f / local.direction, glm::vec3(-0.5f), glm::vec3(0.5f), maxT, tHit);
+    }, hitT);
+    return hit == UINT32_MAX ? -1 : (int)hit;
+}
+
+// λòʱ仯СıʱؽһΰΧСת
+// İΧУ߳ sqrt(3)/2⳯¶Ǳص
+void buildCubeCuller(BoxCuller& culler, int gridSize)
+{
+    culler.clear();
+    culler.reserve((size_t)gridSize * gridSize);
+    glm::vec3 extents(0.8660254f);
+    for (int i = 0; i < gridSize; ++i)
+        for (int j = 0; j < gridSize; ++j)
+            culler.add(cubeGridPosition(i, j), extents);
+}
+
+// ģͣʱ glDrawElements
+void drawMesh(const Mesh& mesh) {
+    glBindVertexArray(mesh.VAO);
+    if (!mesh.indices.empty())
+        glDrawElements(GL_TRIANGLES, (GLsizei)mesh.indices.size(), GL_UNSIGNED_INT, 0);
+    else
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(mesh.vertices.size() / 3));
+}
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
+    // ȾĿһ֡ʼʱ´Сؽ
+    framebufferWidth = width;
+    framebufferHeight = height;
 }
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
@@ -485,6 +1015,72 @@ void processInput(GLFWwindow* window)
     if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
         cameraPos -= cameraSpeed * cameraUp;
 
+    // PageUp/PageDown 
+    static bool gridKeyPressed = false;
+    bool gridUp = glfwGetKey(window, GLFW_KEY_PAGE_UP) == GLFW_PRESS;
+    bool gridDown = glfwGetKey(window, GLFW_KEY_PAGE_DOWN) == GLFW_PRESS;
+    if ((gridUp || gridDown) && !gridKeyPressed)
+    {
+        gridKeyPressed = true;
+        int levels = sizeof(cubeGridSizes) / sizeof(cubeGridSizes[0]);
+        cubeGridLevel = std::max(0, std::min(levels - 1, cubeGridLevel + (gridUp ? 1 : -1)));
+    }
+    if (!gridUp && !gridDown)
+        gridKeyPressed = false;
+
+    // C׶޳
+    static bool cullKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS && !cullKeyPressed)
+    {
+        cullKeyPressed = true;
+        frustumCullingEnabled = !frustumCullingEnabled;
+        std::cout << "׶޳: " << (frustumCullingEnabled ? "" : "") << std::endl;
+    }
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_RELEASE)
+        cullKeyPressed = false;
+
+    // KKawase͸˹֮л
+    static bool kawaseKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS && !kawaseKeyPressed)
+    {
+        kawaseKeyPressed = true;
+        kawaseBloom = !kawaseBloom;
+        std::cout << ": " << (kawaseBloom ? "˫Kawase" : "˹ping-pong") << std::endl;
+    }
+    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_RELEASE)
+        kawaseKeyPressed = false;
+
+    // Rضֱ̬
+    static bool resolutionKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS && !resolutionKeyPressed)
+    {
+        resolutionKeyPressed = true;
+        dynamicResolutionEnabled = !dynamicResolutionEnabled;
+        std::cout << "ֱ̬: " << (dynamicResolutionEnabled ? "" : "") << std::endl;
+    }
+    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_RELEASE)
+        resolutionKeyPressed = false;
+
+    // Pʼ/ֹͣ¼ trace
+    static bool traceKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && !traceKeyPressed)
+    {
+        traceKeyPressed = true;
+        traceToggleRequested = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE)
+        traceKeyPressed = false;
+
+    // ʰȡ
+    static bool pickButtonPressed = false;
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS && !pickButtonPressed)
+    {
+        pickButtonPressed = true;
+        pickRequested = true;
+    }
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_RELEASE)
+        pickButtonPressed = false;
+
     // BлЧ
     static bool bloomKeyPressed = false;
     if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS && !bloomKeyPressed)
@@ -569,12 +1165,17 @@ std::string getResourcePath(const std::string& relativePath) {
 }
 
 
-int main(){
+int main(int argc, char** argv){
+
+    // --benchmarkشڡرմ̶ֱͬʱ䲽Ԥ·Ⱦ̶֡ͳƲ˳
+    BenchmarkOptions benchmark = ParseBenchmarkOptions(argc, argv);
 
+    ApplyBenchmarkInitHints(benchmark);
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    ApplyBenchmarkWindowHints(benchmark);
 
     GLFWwindow* window = glfwCreateWindow(800, 600, "6x6 Cubes with Bloom Effect", NULL, NULL);
     if (!window) {
@@ -590,13 +1191,22 @@ int main(){
     glfwSetScrollCallback(window, scroll_callback);
 
     // ع겢
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    if (!benchmark.enabled)
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         cout << "Failed to initialize GLAD" << endl;
         return -1;
     }
 
+    BenchmarkRun benchmarkRun(benchmark);
+    BenchmarkCapture benchmarkCapture;
+    if (benchmark.enabled) {
+        // ʾˢƣֱ̬ʻýɸ֣׼ʱر
+        glfwSwapInterval(0);
+        dynamicResolutionEnabled = false;
+    }
+
 
 	std::string objPath = getResourcePath("source/objects/teapot/teapot.obj");
 	std::cout << "Դ·: " << objPath << std::endl;
@@ -610,8 +1220,12 @@ int main(){
     unsigned int screenShader = createShaderProgram(screenVertexShaderSource, screenFragmentShaderSource);
     unsigned int blurShader = createShaderProgram(screenVertexShaderSource, blurFragmentShaderSource);
     unsigned int brightShader = createShaderProgram(screenVertexShaderSource, brightFragmentShaderSource);
-	// PBRɫ
+    unsigned int kawaseDownShader = createShaderProgram(screenVertexShaderSource, kawaseDownFragmentShaderSource);
+    unsigned int kawaseUpShader = createShaderProgram(screenVertexShaderSource, kawaseUpFragmentShaderSource);
+	// PBRɫGLstudy ﻹûִعյÿ֡Ͱֻ GLtest 
 	unsigned int pbrShader = createShaderProgram(pbrVertexShaderSource, pbrFragmentShaderSource);
+    // ʵɫ
+    unsigned int instancedShader = createShaderProgram(instancedVertexShaderSource, instancedFragmentShaderSource);
 
     // VAO/VBO
     unsigned int cubeVAO, cubeVBO;
@@ -625,6 +1239,39 @@ int main(){
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
+    // ʵVAOݹ cubeVBOʵʵ
+    unsigned int cubeInstancedVAO;
+    glGenVertexArrays(1, &cubeInstancedVAO);
+    glBindVertexArray(cubeInstancedVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // --instances=N ѡӽNʵ--nocull ر׶޳ --benchmark --instances=100000
+    int levels = sizeof(cubeGridSizes) / sizeof(cubeGridSizes[0]);
+    int instanceParam = benchmark.intParam("instances", 0);
+    for (int level = 0; instanceParam > 0 && level < levels; level++) {
+        long long size = (long long)cubeGridSizes[level] * cubeGridSizes[level];
+        long long best = (long long)cubeGridSizes[cubeGridLevel] * cubeGridSizes[cubeGridLevel];
+        if (std::llabs(size - instanceParam) < std::llabs(best - instanceParam))
+            cubeGridLevel = level;
+    }
+    if (benchmark.flag("nocull"))
+        frustumCullingEnabled = false;
+
+    InstanceBuffer cubeInstances;
+    int cubeGridSize = cubeGridSizes[cubeGridLevel];
+    createInstanceBuffer(cubeInstances, (size_t)cubeGridSize * cubeGridSize);
+    BoxCuller cubeCuller;
+    buildCubeCuller(cubeCuller, cubeGridSize);
+    std::vector<uint32_t> visibleCubes;
+    Bvh cubeBvh;
+    std::vector<Aabb> cubeBoxes;
+    buildCubeBvh(cubeBvh, cubeBoxes, cubeGridSize);
+    int pickedCube = -1;        // ʰȡʾ-1 ʾû
+    bool teapotPicked = false;
+    cout << "ʵ: " << (cubeInstances.persistent ? "־ӳ" : "ÿ֡ϴ") << endl;
+
     // ĻıVAO/VBO
     unsigned int quadVAO, quadVBO;
     glGenVertexArrays(1, &quadVAO);
@@ -662,61 +1309,41 @@ int main(){
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
-    // ֡
-    unsigned int hdrFBO;
-    glGenFramebuffers(1, &hdrFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-
-    // ɫ (һȾһڸ߹ȡ)
-    unsigned int colorBuffers[2];
-    glGenTextures(2, colorBuffers);
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, 800, 600, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        // ӵ֡
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0);
-    }
-
-    // ȾȺģ
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, 800, 600);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-
-    // OpenGLҪʹĸɫȾ
-    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers(2, attachments);
-
-    // ֡Ƿ
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        cout << "Framebuffer not complete!" << endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // ģping-pong֡
-    unsigned int pingpongFBO[2];
-    unsigned int pingpongColorbuffers[2];
-    glGenFramebuffers(2, pingpongFBO);
-    glGenTextures(2, pingpongColorbuffers);
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, 800, 600, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongColorbuffers[i], 0);
-
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            cout << "Framebuffer not complete!" << endl;
-    }
+    // ȾĿ꣨HDRӳаǰֱʻȡڴСȾ仯ʱԶؽ
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    RenderTargetPool renderTargets(framebufferWidth, framebufferHeight);
+
+    // ͷGPUʱ
+    GpuTimer sceneTimer, bloomTimer;
+    createGpuTimer(sceneTimer);
+    createGpuTimer(bloomTimer);
+    double sceneGpuMs = 0.0, bloomGpuMs = 0.0;
+    int sceneGpuSamples = 0, bloomGpuSamples = 0;
+
+    // ֱ̬ʿÿ֡ѡ¼csvļ߷
+    DynamicResolution resolutionController(RENDER_BUDGET_MS, 0.5f, 1.0f);
+    resolutionController.openLog("resolution_scale.csv");
+
+
+    // Ⱦѭѯһ uniform λãѭвַ
+    GLint cubeViewLoc = glGetUniformLocation(cubeShader, "view");
+    GLint cubeProjectionLoc = glGetUniformLocation(cubeShader, "projection");
+    GLint cubeModelLoc = glGetUniformLocation(cubeShader, "model");
+    GLint cubeColorLoc = glGetUniformLocation(cubeShader, "color");
+    GLint brightSceneLoc = glGetUniformLocation(brightShader, "scene");
+    GLint blurHorizontalLoc = glGetUniformLocation(blurShader, "horizontal");
+    GLint screenSceneLoc = glGetUniformLocation(screenShader, "scene");
+    GLint screenBloomBlurLoc = glGetUniformLocation(screenShader, "bloomBlur");
+    GLint screenExposureLoc = glGetUniformLocation(screenShader, "exposure");
+    GLint screenBloomLoc = glGetUniformLocation(screenShader, "bloom");
+    GLint screenUpscaleLoc = glGetUniformLocation(screenShader, "upscale");
+    GLint kawaseDownImageLoc = glGetUniformLocation(kawaseDownShader, "image");
+    GLint kawaseDownHalfPixelLoc = glGetUniformLocation(kawaseDownShader, "halfPixel");
+    GLint kawaseDownPrefilterLoc = glGetUniformLocation(kawaseDownShader, "prefilter");
+    GLint kawaseUpImageLoc = glGetUniformLocation(kawaseUpShader, "image");
+    GLint kawaseUpHalfPixelLoc = glGetUniformLocation(kawaseUpShader, "halfPixel");
+    GLint instancedViewLoc = glGetUniformLocation(instancedShader, "view");
+    GLint instancedProjectionLoc = glGetUniformLocation(instancedShader, "projection");
 
     // Ȳ
     glEnable(GL_DEPTH_TEST);
@@ -725,14 +1352,76 @@ int main(){
     bool bloom = true;
     float exposure = 1.0f;
 
+    // ÿpassCPU/GPUʱ䣬ÿһλ
+    Profiler profiler;
+
+    // ֡ʱͳƣÿһεǰʵƽ֡ʱ
+    double statsStart = glfwGetTime();
+    int statsFrames = 0;
+    bool statsKawase = kawaseBloom;
+    size_t statsVisible = 0, statsCulled = 0;   // ͳڼɼ/޳壨ģ+ʵ
+
     // Ⱦѭ
     while (!glfwWindowShouldClose(window))
     {
-        processInput(window);
+        profiler.beginFrame();
+        int frameScope = profiler.begin("frame");
+        if (benchmark.enabled) {
+            // Ԥ·Ƴƶʼտ
+            float t = (float)benchmarkRun.time();
+            cameraPos = glm::vec3(6.0f * sin(t * 0.5f), 1.0f + 2.0f * sin(t * 0.3f), 15.0f + 3.0f * cos(t * 0.5f));
+            cameraFront = glm::normalize(glm::vec3(0.0f, -1.0f, -5.0f) - cameraPos);
+        }
+        else
+            processInput(window);
+
+        if (traceToggleRequested) {
+            traceToggleRequested = false;
+            if (profiler.tracing()) {
+                profiler.stopTrace();
+                cout << "trace ѱ浽 frame_trace.json" << endl;
+            }
+            else if (profiler.startTrace("frame_trace.json", TRACE_MAX_FRAMES)) {
+                cout << "ʼ¼ trace " << TRACE_MAX_FRAMES << " ֡" << endl;
+            }
+        }
+
+        if (!dynamicResolutionEnabled)
+            resolutionController.reset();
+        renderTargets.setRenderScale(resolutionController.scale());
+        renderTargets.resize(framebufferWidth, framebufferHeight);
+        if (renderTargets.beginFrame())
+            renderTargets.report();
+        int renderWidth = renderTargets.renderWidth();
+        int renderHeight = renderTargets.renderHeight();
+
+        // С仯ʱؽʵ
+        if (cubeGridSizes[cubeGridLevel] != cubeGridSize) {
+            cubeGridSize = cubeGridSizes[cubeGridLevel];
+            createInstanceBuffer(cubeInstances, (size_t)cubeGridSize * cubeGridSize);
+            buildCubeCuller(cubeCuller, cubeGridSize);
+            buildCubeBvh(cubeBvh, cubeBoxes, cubeGridSize);
+            pickedCube = -1;
+            statsStart = glfwGetTime();
+            statsFrames = 0;
+            statsVisible = statsCulled = 0;
+        }
+        // лʵֺͳƣʵֵʱһ
+        if (kawaseBloom != statsKawase) {
+            statsKawase = kawaseBloom;
+            statsStart = glfwGetTime();
+            statsFrames = 0;
+            statsVisible = statsCulled = 0;
+            bloomGpuMs = 0.0;
+            bloomGpuSamples = 0;
+        }
 
         // 1. Ⱦ֡
-        glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-        glViewport(0, 0, 800, 600);  // ȷӿڴСȷ
+        RenderTarget sceneTarget = renderTargets.acquireScaled(GL_RGBA16F, true);
+        beginGpuTimer(sceneTimer);
+        int sceneScope = profiler.begin("scene");
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneTarget.fbo);
+        glViewport(0, 0, renderWidth, renderHeight);  // ȷӿڴСȷ
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);  // ʹɫ
 
@@ -740,10 +1429,11 @@ int main(){
 
         // ͼͶӰ
         glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-        glm::mat4 projection = glm::perspective(glm::radians(fov), 800.0f / 600.0f, 0.1f, 100.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(fov),
+            (float)renderTargets.outputWidth() / renderTargets.outputHeight(), 0.1f, 100.0f);
 
-        glUniformMatrix4fv(glGetUniformLocation(cubeShader, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(cubeShader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        glUniformMatrix4fv(cubeViewLoc, 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(cubeProjectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
 
         // Ⱦ
         glUseProgram(cubeShader);
@@ -752,124 +1442,290 @@ int main(){
         model = glm::scale(model, glm::vec3(0.5f));
      /*   model = glm::rotate(model, (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f));*/
 
-        glUniformMatrix4fv(glGetUniformLocation(cubeShader, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniform3fv(glGetUniformLocation(cubeShader, "color"), 1, glm::value_ptr(glm::vec3(0.8f, 0.3f, 0.2f)));
+        // ʰȡĻĵߣģģͿռBVH󽻣refit弶BVH
+        float time = benchmark.enabled ? (float)benchmarkRun.time() : (float)glfwGetTime();
+        if (pickRequested) {
+            pickRequested = false;
+            Ray ray = ScreenRay(renderTargets.outputWidth() * 0.5f, renderTargets.outputHeight() * 0.5f,
+                (float)renderTargets.outputWidth(), (float)renderTargets.outputHeight(), view, projection);
+            auto pickStart = std::chrono::steady_clock::now();
+            glm::mat4 inverseModel = glm::inverse(model);
+            Ray modelRay;
+            modelRay.origin = glm::vec3(inverseModel * glm::vec4(ray.origin, 1.0f));
+            modelRay.direction = glm::vec3(inverseModel * glm::vec4(ray.direction, 0.0f));
+            float teapotT = raycastMesh(teapot, modelRay);
+            float cubeT;
+            int cube = pickCube(cubeBvh, cubeBoxes, cubeGridSize, time, ray, cubeT);
+            double pickMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pickStart).count();
+
+            teapotPicked = teapotT < FLT_MAX && (cube < 0 || teapotT < cubeT);
+            pickedCube = teapotPicked ? -1 : cube;
+            if (teapotPicked)
+                cout << "ʰȡ:  : " << teapotT;
+            else if (pickedCube >= 0)
+                cout << "ʰȡ:  (" << pickedCube / cubeGridSize << ", " << pickedCube % cubeGridSize << ") : " << cubeT;
+            else
+                cout << "ʰȡ: ";
+            cout << " ʱ: " << pickMs << " ms" << endl;
+        }
+
+        glUniformMatrix4fv(cubeModelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        glUniform3fv(cubeColorLoc, 1, glm::value_ptr(teapotPicked ? glm::vec3(4.0f) : glm::vec3(0.8f, 0.3f, 0.2f)));
 
-		glBindVertexArray(teapot.VAO);
-		glDrawArrays(GL_TRIANGLES, 0, teapot.vertices.size() / 3);
+        // ׶޳ģ MVP õģͿռ׶ֱӺͼʱİΧ
+        size_t visibleObjects = 0, culledObjects = 0;
+        if (!frustumCullingEnabled || Frustum::FromMatrix(projection * view * model).intersects(teapot.bounds)) {
+            drawMesh(teapot);
+            visibleObjects++;
+        }
+        else
+            culledObjects++;
+
+        // SIMD׶ԣֻΪɼʵдʵ
+        size_t cubeCount = (size_t)cubeGridSize * cubeGridSize;
+        if (frustumCullingEnabled)
+            cubeCuller.cull(Frustum::FromMatrix(projection * view), visibleCubes);
+        else if (visibleCubes.size() != cubeCount) {
+            visibleCubes.resize(cubeCount);
+            for (size_t k = 0; k < cubeCount; ++k)
+                visibleCubes[k] = (uint32_t)k;
+        }
+        visibleObjects += visibleCubes.size();
+        culledObjects += cubeCount - visibleCubes.size();
 
-        // 6x636
-        glBindVertexArray(cubeVAO);
-        for (int i = 0; i < 1; ++i)
+        // ƿɼ壺Ȱʵдʵ壬һ glDrawArraysInstanced 
+        CubeInstance* instances = beginInstanceWrite(cubeInstances);
+        for (size_t k = 0; k < visibleCubes.size(); ++k)
         {
-            for (int j = 0; j < 6; ++j)
-            {
-                // ޸λãʹ3Dռзֲ
-                glm::vec3 cubePos = glm::vec3(
-                    i * 2.0f - 5.0f,  // x: -55
-                    j * 1.5f - 4.0f,  // y: -44
-                    (i + j) * -1.5f   // z: ȱ仯
-                );
-
-                // ģ;
-                glm::mat4 model = glm::mat4(1.0f);
-                model = glm::translate(model, cubePos);
-                // һЩתʹ忴
-                model = glm::rotate(model, (float)glfwGetTime() * glm::radians(20.0f * (i + j)),
-                    glm::vec3(0.5f, 1.0f, 0.0f));
-
-                // ɫʹһЩԲЧ
-                glm::vec3 cubeColor = glm::vec3(
-                    i * 0.15f + 0.2f,
-                    j * 0.15f + 0.2f,
-                    0.5f + i * 0.1f
-                );
-                if ((i + j) % 3 == 0) // ʹ
-                    cubeColor *= 3.0f;
-
-                // ģ;ɫɫ
-                glUniformMatrix4fv(glGetUniformLocation(cubeShader, "model"), 1, GL_FALSE, glm::value_ptr(model));
-                glUniform3fv(glGetUniformLocation(cubeShader, "color"), 1, glm::value_ptr(cubeColor));
-
-                // 
-                glDrawArrays(GL_TRIANGLES, 0, 36);
-            }
+            int i = (int)(visibleCubes[k] / cubeGridSize);
+            int j = (int)(visibleCubes[k] % cubeGridSize);
+
+            glm::mat4 model = cubeModelMatrix(i, j, time);
+
+            // ɫʹһЩԲЧ
+            glm::vec3 cubeColor = glm::vec3(
+                i * 0.15f + 0.2f,
+                j * 0.15f + 0.2f,
+                0.5f + i * 0.1f
+            );
+            if ((i + j) % 3 == 0) // ʹ
+                cubeColor *= 3.0f;
+            if ((int)visibleCubes[k] == pickedCube)
+                cubeColor = glm::vec3(4.0f);
+
+            CubeInstance& instance = instances[k];
+            instance.model = model;
+            instance.color = glm::vec4(cubeColor, 1.0f);
         }
+        size_t instanceCount = visibleCubes.size();
+        endInstanceWrite(cubeInstances, cubeInstancedVAO, instanceCount);
 
-		// ù
-		glm::vec3 lightPositions[] = {
-			glm::vec3(-10.0f,  10.0f, 10.0f),
-			glm::vec3(10.0f,  10.0f, 10.0f),
-			glm::vec3(-10.0f, -10.0f, 10.0f),
-			glm::vec3(10.0f, -10.0f, 10.0f)
-		};
-		glm::vec3 lightColors[] = {
-			glm::vec3(300.0f, 300.0f, 300.0f),
-			glm::vec3(300.0f, 300.0f, 300.0f),
-			glm::vec3(300.0f, 300.0f, 300.0f),
-			glm::vec3(300.0f, 300.0f, 300.0f)
-		};
-		glUniform3fv(glGetUniformLocation(pbrShader, "lightPositions"), 4, glm::value_ptr(lightPositions[0]));
-		glUniform3fv(glGetUniformLocation(pbrShader, "lightColors"), 4, glm::value_ptr(lightColors[0]));
-		glUniform3fv(glGetUniformLocation(pbrShader, "viewPos"), 1, glm::value_ptr(cameraPos));
-
-		// ͼͶӰ
-		glUniformMatrix4fv(glGetUniformLocation(pbrShader, "view"), 1, GL_FALSE, glm::value_ptr(view));
-		glUniformMatrix4fv(glGetUniformLocation(pbrShader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-
-        // 2. ȡ߹ⲿֵڶɫ
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[0]);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glUseProgram(brightShader);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[1]); // ʹõڶɫ
-        glUniform1i(glGetUniformLocation(brightShader, "scene"), 0);
+        glUseProgram(instancedShader);
+        glUniformMatrix4fv(instancedViewLoc, 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(instancedProjectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+        glBindVertexArray(cubeInstancedVAO);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)instanceCount);
+        fenceInstanceWrite(cubeInstances);
+
+
+        // 2/3. ȡ߹ⲢģΪ bloomResult
+        profiler.end(sceneScope);
+        double sceneMs = 0.0;
+        bool sceneTimed = endGpuTimer(sceneTimer, sceneMs);
+
+        RenderTarget bloomResult;
+        beginGpuTimer(bloomTimer);
+        int bloomScope = profiler.begin("bloom");
         glBindVertexArray(quadVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glActiveTexture(GL_TEXTURE0);
+        if (kawaseBloom)
+        {
+            ProfileScope kawaseScope(profiler, "kawase");
+
+            //  -> 1/2 -> ... -> 1/32һͬʱֵ
+            int downScope = profiler.begin("downsample");
+            RenderTarget bloomMips[BLOOM_MIPS];
+            glUseProgram(kawaseDownShader);
+            glUniform1i(kawaseDownImageLoc, 0);
+            for (int i = 0; i < BLOOM_MIPS; i++)
+            {
+                // ⲻҪalphaR11F_G11F_B10Fٴ
+                const RenderTarget& source = i == 0 ? sceneTarget : bloomMips[i - 1];
+                bloomMips[i] = renderTargets.acquire(source.width / 2, source.height / 2, GL_R11F_G11F_B10F);
+                glBindFramebuffer(GL_FRAMEBUFFER, bloomMips[i].fbo);
+                glViewport(0, 0, bloomMips[i].width, bloomMips[i].height);
+                glBindTexture(GL_TEXTURE_2D, source.texture);
+                glUniform2f(kawaseDownHalfPixelLoc, 0.5f / bloomMips[i].width, 0.5f / bloomMips[i].height);
+                glUniform1i(kawaseDownPrefilterLoc, i == 0);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+            }
 
-        // 3. Ը߹ⲿӦø˹ģ
-        bool horizontal = true, first_iteration = true;
-        unsigned int amount = 10; // ģ
-        glUseProgram(blurShader);
-        for (unsigned int i = 0; i < amount; i++)
+            profiler.end(downScope);
+
+            // 𼶷Ŵ 1/2 ֱʣÿǵѾùĽС
+            int upScope = profiler.begin("upsample");
+            glUseProgram(kawaseUpShader);
+            glUniform1i(kawaseUpImageLoc, 0);
+            for (int i = BLOOM_MIPS - 2; i >= 0; i--)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, bloomMips[i].fbo);
+                glViewport(0, 0, bloomMips[i].width, bloomMips[i].height);
+                glBindTexture(GL_TEXTURE_2D, bloomMips[i + 1].texture);
+                glUniform2f(kawaseUpHalfPixelLoc, 0.5f / bloomMips[i].width, 0.5f / bloomMips[i].height);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+                renderTargets.release(bloomMips[i + 1]);
+            }
+            profiler.end(upScope);
+            bloomResult = bloomMips[0];
+        }
+        else
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
-            glUniform1i(glGetUniformLocation(blurShader, "horizontal"), horizontal);
-            glBindTexture(GL_TEXTURE_2D, first_iteration ? pingpongColorbuffers[0] : pingpongColorbuffers[!horizontal]);
+            ProfileScope gaussianScope(profiler, "gaussian");
+
+            // 2. ȡ߹ⲿ
+            int brightScope = profiler.begin("bright pass");
+            RenderTarget pingpong[2] = {
+                renderTargets.acquireScaled(GL_RGBA16F),
+                renderTargets.acquireScaled(GL_RGBA16F)
+            };
+            glViewport(0, 0, renderWidth, renderHeight);
+            glBindFramebuffer(GL_FRAMEBUFFER, pingpong[0].fbo);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glUseProgram(brightShader);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, sceneTarget.texture); // ӳɫȡ
+            glUniform1i(brightSceneLoc, 0);
+            glBindVertexArray(quadVAO);
             glDrawArrays(GL_TRIANGLES, 0, 6);
-            horizontal = !horizontal;
-            if (first_iteration)
-                first_iteration = false;
-        }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        // 4. ȾзЧHDRɫ嵽Ĭ֡
+            profiler.end(brightScope);
+
+            // 3. ȫֱ¶Ը߹ⲿӦø˹ģ
+            int blurScope = profiler.begin("blur");
+            bool horizontal = true, first_iteration = true;
+            unsigned int amount = 10; // ģ
+            glUseProgram(blurShader);
+            for (unsigned int i = 0; i < amount; i++)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, pingpong[horizontal].fbo);
+                glUniform1i(blurHorizontalLoc, horizontal);
+                glBindTexture(GL_TEXTURE_2D, first_iteration ? pingpong[0].texture : pingpong[!horizontal].texture);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+                horizontal = !horizontal;
+                if (first_iteration)
+                    first_iteration = false;
+            }
+            bloomResult = pingpong[!horizontal];
+            renderTargets.release(pingpong[horizontal]);
+            profiler.end(blurScope);
+        }
+        profiler.end(bloomScope);
+        double bloomMs = 0.0;
+        bool bloomTimed = endGpuTimer(bloomTimer, bloomMs);
+
+        // һ֡ĳ+ʱһ֡Ⱦֱʣû׼þһ֡
+        if (sceneTimed) {
+            sceneGpuMs += sceneMs;
+            sceneGpuSamples++;
+        }
+        if (bloomTimed) {
+            bloomGpuMs += bloomMs;
+            bloomGpuSamples++;
+        }
+        if (sceneTimed && bloomTimed && dynamicResolutionEnabled)
+            resolutionController.update((float)(sceneMs + bloomMs));
+        // شڵĬ֡δģ׼Եһ֡ϳɵԼ֡ٶ
+        bool captureFrame = benchmark.enabled && benchmarkRun.lastFrame();
+        glBindFramebuffer(GL_FRAMEBUFFER, benchmarkCapture.target(captureFrame, renderTargets.outputWidth(), renderTargets.outputHeight()));
+
+        // 4. ȾзЧHDRɫ嵽Ĭ֡壬ȾֱСڴʱŴ
+        int compositeScope = profiler.begin("composite");
+        glViewport(0, 0, renderTargets.outputWidth(), renderTargets.outputHeight());
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glUseProgram(screenShader);
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[0]); // Ⱦɫ
-        glUniform1i(glGetUniformLocation(screenShader, "scene"), 0);
+        glBindTexture(GL_TEXTURE_2D, sceneTarget.texture); // Ⱦɫ
+        glUniform1i(screenSceneLoc, 0);
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[!horizontal]); // ģĸ߹ɫ
-        glUniform1i(glGetUniformLocation(screenShader, "bloomBlur"), 1);
-        glUniform1f(glGetUniformLocation(screenShader, "exposure"), exposure);
-        glUniform1i(glGetUniformLocation(screenShader, "bloom"), bloom);
+        glBindTexture(GL_TEXTURE_2D, bloomResult.texture); // ģĸ߹ɫ
+        glUniform1i(screenBloomBlurLoc, 1);
+        glUniform1f(screenExposureLoc, exposure);
+        glUniform1i(screenBloomLoc, bloom);
+        glUniform1i(screenUpscaleLoc, renderWidth < renderTargets.outputWidth());
         glBindVertexArray(quadVAO);
         glDrawArrays(GL_TRIANGLES, 0, 6);
 
+        renderTargets.release(bloomResult);
+        renderTargets.release(sceneTarget);
+        renderTargets.endFrame();
+        profiler.end(compositeScope);
+
+        // һ֡ڽǰأУȷϲͬȾһ
+        if (captureFrame)
+            benchmarkRun.setChecksum(benchmarkCapture.checksum());
+
+        int swapScope = profiler.begin("swap");
         glfwSwapBuffers(window);
+        profiler.end(swapScope);
         glfwPollEvents();
+        profiler.end(frameScope);
+        profiler.endFrame();
+
+        if (benchmark.enabled) {
+            benchmarkRun.frameEnd();
+            if (benchmarkRun.finished())
+                break;
+        }
+
+        statsFrames++;
+        statsVisible += visibleObjects;
+        statsCulled += culledObjects;
+        double statsElapsed = glfwGetTime() - statsStart;
+        if (statsElapsed >= 1.0) {
+            cout << "ʵ: " << (size_t)cubeGridSize * cubeGridSize
+                << " ɼ: " << statsVisible / statsFrames << " ޳: " << statsCulled / statsFrames
+                << " ƽ֡ʱ: " << statsElapsed * 1000.0 / statsFrames << " ms"
+                << " GPU: " << (sceneGpuSamples ? sceneGpuMs / sceneGpuSamples : 0.0) << " ms"
+                << " (" << (kawaseBloom ? "Kawase" : "˹") << ") GPU: "
+                << (bloomGpuSamples ? bloomGpuMs / bloomGpuSamples : 0.0) << " ms"
+                << " ȾĿԴ: " << renderTargets.allocatedBytes() / (1024.0 * 1024.0)
+                << " MB ֵ: " << renderTargets.peakBytes() / (1024.0 * 1024.0) << " MB"
+                << " Ⱦ: " << renderTargets.renderScale() << endl;
+            profiler.report();
+            statsStart = glfwGetTime();
+            statsFrames = 0;
+            statsVisible = statsCulled = 0;
+            sceneGpuMs = 0.0;
+            sceneGpuSamples = 0;
+            bloomGpuMs = 0.0;
+            bloomGpuSamples = 0;
+        }
     }
 
+    if (benchmark.enabled)
+        benchmarkRun.report("GLstudy instances=" + std::to_string((size_t)cubeGridSize * cubeGridSize) +
+            (frustumCullingEnabled ? " cull" : " nocull"), (const char*)glGetString(GL_RENDERER));
+
     glDeleteVertexArrays(1, &cubeVAO);
+    glDeleteVertexArrays(1, &cubeInstancedVAO);
     glDeleteBuffers(1, &cubeVBO);
+    glDeleteBuffers(1, &cubeInstances.VBO);
     glDeleteVertexArrays(1, &quadVAO);
     glDeleteBuffers(1, &quadVBO);
     glDeleteProgram(cubeShader);
     glDeleteProgram(screenShader);
     glDeleteProgram(blurShader);
     glDeleteProgram(brightShader);
+    glDeleteProgram(instancedShader);
+    glDeleteProgram(pbrShader);
+    glDeleteProgram(kawaseDownShader);
+    glDeleteProgram(kawaseUpShader);
+    renderTargets.clear();
+    benchmarkCapture.release();
+    glDeleteQueries(2, sceneTimer.queries);
+    glDeleteQueries(2, bloomTimer.queries);
+    profiler.stopTrace();
+    profiler.release();
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
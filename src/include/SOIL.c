@@ -78,6 +78,14 @@ int query_DXT_capability( void );
 #define SOIL_RGBA_S3TC_DXT1		0x83F1
 #define SOIL_RGBA_S3TC_DXT3		0x83F2
 #define SOIL_RGBA_S3TC_DXT5		0x83F3
+/*	for the BC4/BC5 (RGTC) and BC7 (BPTC) formats picked by texture role	*/
+static int has_RGTC_capability = SOIL_CAPABILITY_UNKNOWN;
+int query_RGTC_capability( void );
+static int has_BPTC_capability = SOIL_CAPABILITY_UNKNOWN;
+int query_BPTC_capability( void );
+#define SOIL_RED_RGTC1			0x8DBB
+#define SOIL_RG_RGTC2			0x8DBD
+#define SOIL_RGBA_BPTC_UNORM	0x8E8C
 typedef void (APIENTRY * P_SOIL_GLCOMPRESSEDTEXIMAGE2DPROC) (GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid * data);
 P_SOIL_GLCOMPRESSEDTEXIMAGE2DPROC soilGlCompressedTexImage2D = NULL;
 unsigned int SOIL_direct_load_DDS(
@@ -977,6 +985,33 @@ void check_for_GL_errors( const char *calling_location )
 }
 #endif
 
+/*	compresses an image to one of the formats I can encode myself	*/
+static unsigned char*
+	SOIL_compress_image
+	(
+		unsigned int internal_texture_format,
+		const unsigned char *const img,
+		int width, int height, int channels,
+		int *out_size
+	)
+{
+	switch( internal_texture_format )
+	{
+	case SOIL_RGB_S3TC_DXT1:
+		return convert_image_to_DXT1( img, width, height, channels, out_size );
+	case SOIL_RGBA_S3TC_DXT5:
+		return convert_image_to_DXT5( img, width, height, channels, out_size );
+	case SOIL_RED_RGTC1:
+		return convert_image_to_BC4( img, width, height, channels, out_size );
+	case SOIL_RG_RGTC2:
+		return convert_image_to_BC5( img, width, height, channels, out_size );
+	case SOIL_RGBA_BPTC_UNORM:
+		return convert_image_to_BC7( img, width, height, channels, out_size );
+	}
+	*out_size = 0;
+	return NULL;
+}
+
 unsigned int
 	SOIL_internal_create_OGL_texture
 	(
@@ -1206,6 +1241,21 @@ unsigned int
 					/*	2 or 4 channels = DXT5	*/
 					internal_texture_format = SOIL_RGBA_S3TC_DXT5;
 				}
+				/*	the texture's role may ask for a better suited format,
+					4x (BC5, BC7) to 8x (BC4) smaller than RGBA8	*/
+				if( (flags & SOIL_FLAG_SCALAR_MAP) &&
+					(query_RGTC_capability() == SOIL_CAPABILITY_PRESENT) )
+				{
+					internal_texture_format = SOIL_RED_RGTC1;
+				} else if( (flags & SOIL_FLAG_NORMAL_MAP) &&
+					(query_RGTC_capability() == SOIL_CAPABILITY_PRESENT) )
+				{
+					internal_texture_format = SOIL_RG_RGTC2;
+				} else if( (flags & SOIL_FLAG_ALBEDO_MAP) &&
+					(query_BPTC_capability() == SOIL_CAPABILITY_PRESENT) )
+				{
+					internal_texture_format = SOIL_RGBA_BPTC_UNORM;
+				}
 			}
 		}
 		/*  bind an OpenGL texture ID	*/
@@ -1216,16 +1266,8 @@ unsigned int
 		{
 			/*	user wants me to do the DXT conversion!	*/
 			int DDS_size;
-			unsigned char *DDS_data = NULL;
-			if( (channels & 1) == 1 )
-			{
-				/*	RGB, use DXT1	*/
-				DDS_data = convert_image_to_DXT1( img, width, height, channels, &DDS_size );
-			} else
-			{
-				/*	RGBA, use DXT5	*/
-				DDS_data = convert_image_to_DXT5( img, width, height, channels, &DDS_size );
-			}
+			unsigned char *DDS_data = SOIL_compress_image(
+					internal_texture_format, img, width, height, channels, &DDS_size );
 			if( DDS_data )
 			{
 				soilGlCompressedTexImage2D(
@@ -1259,33 +1301,47 @@ unsigned int
 		if( flags & SOIL_FLAG_MIPMAPS )
 		{
 			int MIPlevel = 1;
-			int MIPwidth = (width+1) / 2;
-			int MIPheight = (height+1) / 2;
-			unsigned char *resampled = (unsigned char*)malloc( channels*MIPwidth*MIPheight );
-			while( ((1<<MIPlevel) <= width) || ((1<<MIPlevel) <= height) )
+			int MIPlevels;
+			int MIPwidth = width;
+			int MIPheight = height;
+			int MIPflags = 0;
+			unsigned char *chain = (unsigned char*)malloc( mipmap_chain_size( width, height, channels ) );
+			unsigned char *resampled;
+			/*	the whole chain at once, Kaiser filtered; YCoCg data is neither sRGB nor normals	*/
+			if( !(flags & SOIL_FLAG_CoCg_Y) )
+			{
+				if( flags & SOIL_FLAG_ALBEDO_MAP )
+				{
+					MIPflags |= MIPMAP_SRGB;
+				}
+				if( flags & SOIL_FLAG_NORMAL_MAP )
+				{
+					MIPflags |= MIPMAP_NORMAL_MAP;
+				}
+			}
+			if( flags & SOIL_FLAG_ALPHA_COVERAGE )
+			{
+				MIPflags |= MIPMAP_ALPHA_COVERAGE;
+			}
+			if( flags & SOIL_FLAG_TEXTURE_REPEATS )
+			{
+				MIPflags |= MIPMAP_WRAP;
+			}
+			MIPlevels = build_mipmap_chain( img, width, height, channels,
+					MIPMAP_FILTER_KAISER, MIPflags, chain );
+			resampled = chain + width*height*channels;
+			while( MIPlevel < MIPlevels )
 			{
-				/*	do this MIPmap level	*/
-				mipmap_image(
-						img, width, height, channels,
-						resampled,
-						(1 << MIPlevel), (1 << MIPlevel) );
+				/*	sizes as OpenGL expects them: halved, rounded down, at least 1	*/
+				MIPwidth = (MIPwidth > 1) ? MIPwidth / 2 : 1;
+				MIPheight = (MIPheight > 1) ? MIPheight / 2 : 1;
 				/*  upload the MIPmaps	*/
 				if( DXT_mode == SOIL_CAPABILITY_PRESENT )
 				{
 					/*	user wants me to do the DXT conversion!	*/
 					int DDS_size;
-					unsigned char *DDS_data = NULL;
-					if( (channels & 1) == 1 )
-					{
-						/*	RGB, use DXT1	*/
-						DDS_data = convert_image_to_DXT1(
-								resampled, MIPwidth, MIPheight, channels, &DDS_size );
-					} else
-					{
-						/*	RGBA, use DXT5	*/
-						DDS_data = convert_image_to_DXT5(
-								resampled, MIPwidth, MIPheight, channels, &DDS_size );
-					}
+					unsigned char *DDS_data = SOIL_compress_image(
+							internal_texture_format, resampled, MIPwidth, MIPheight, channels, &DDS_size );
 					if( DDS_data )
 					{
 						soilGlCompressedTexImage2D(
@@ -1313,11 +1369,10 @@ unsigned int
 					check_for_GL_errors( "glTexImage2D" );
 				}
 				/*	prep for the next level	*/
+				resampled += MIPwidth*MIPheight*channels;
 				++MIPlevel;
-				MIPwidth = (MIPwidth + 1) / 2;
-				MIPheight = (MIPheight + 1) / 2;
 			}
-			SOIL_free_image_data( resampled );
+			SOIL_free_image_data( chain );
 			/*	instruct OpenGL to use the MIPmaps	*/
 			glTexParameteri( opengl_texture_type, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
 			glTexParameteri( opengl_texture_type, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
@@ -1870,15 +1925,143 @@ unsigned int SOIL_direct_load_DDS(
 	return tex_ID;
 }
 
+/*	GL 3.0 enums, not in every <GL/gl.h>	*/
+#ifndef GL_NUM_EXTENSIONS
+#define GL_NUM_EXTENSIONS		0x821D
+#endif
+#ifndef GL_MAJOR_VERSION
+#define GL_MAJOR_VERSION		0x821B
+#define GL_MINOR_VERSION		0x821C
+#endif
+typedef const GLubyte * (APIENTRY * P_SOIL_GLGETSTRINGIPROC) (GLenum name, GLuint index);
+typedef void (APIENTRY * P_SOIL_GLPROC) (void);
+
+/*	address of a GL function, NULL if the driver doesn't have it	*/
+static P_SOIL_GLPROC SOIL_GL_proc_address( const char *name )
+{
+	P_SOIL_GLPROC addr = NULL;
+	#ifdef WIN32
+		addr = (P_SOIL_GLPROC)wglGetProcAddress( name );
+	#elif defined(__APPLE__) || defined(__APPLE_CC__)
+		/*	I can't test this Apple stuff!	*/
+		CFBundleRef bundle;
+		CFURLRef bundleURL =
+			CFURLCreateWithFileSystemPath(
+				kCFAllocatorDefault,
+				CFSTR("/System/Library/Frameworks/OpenGL.framework"),
+				kCFURLPOSIXPathStyle,
+				true );
+		CFStringRef extensionName =
+			CFStringCreateWithCString(
+				kCFAllocatorDefault,
+				name,
+				kCFStringEncodingASCII );
+		bundle = CFBundleCreate( kCFAllocatorDefault, bundleURL );
+		assert( bundle != NULL );
+		addr = (P_SOIL_GLPROC)CFBundleGetFunctionPointerForName( bundle, extensionName );
+		CFRelease( bundleURL );
+		CFRelease( extensionName );
+		CFRelease( bundle );
+	#else
+		addr = (P_SOIL_GLPROC)glXGetProcAddressARB( (const GLubyte *)name );
+	#endif
+	return addr;
+}
+
+/*	whether the context is at least version major.minor, for features that became core	*/
+static int SOIL_GL_version_at_least( int major, int minor )
+{
+	GLint context_major = 0, context_minor = 0;
+	glGetIntegerv( GL_MAJOR_VERSION, &context_major );
+	glGetIntegerv( GL_MINOR_VERSION, &context_minor );
+	if( context_major == 0 )
+	{
+		/*	before 3.0 those enums don't exist, parse "major.minor ..." instead	*/
+		const char *version = (const char*)glGetString( GL_VERSION );
+		while( glGetError() != GL_NO_ERROR )
+		{
+		}
+		if( NULL == version )
+		{
+			return 0;
+		}
+		context_major = atoi( version );
+		version = strchr( version, '.' );
+		context_minor = (NULL != version) ? atoi( version + 1 ) : 0;
+	}
+	return (context_major > major) || ((context_major == major) && (context_minor >= minor));
+}
+
+/*	core profiles have no GL_EXTENSIONS string, their extensions are listed by glGetStringi	*/
+static int SOIL_has_extension( const char *name )
+{
+	const char *extensions = (const char*)glGetString( GL_EXTENSIONS );
+	if( NULL != extensions )
+	{
+		return (NULL != strstr( extensions, name ));
+	}
+	while( glGetError() != GL_NO_ERROR )
+	{
+	}
+	if( SOIL_GL_version_at_least( 3, 0 ) )
+	{
+		P_SOIL_GLGETSTRINGIPROC get_stringi =
+			(P_SOIL_GLGETSTRINGIPROC)SOIL_GL_proc_address( "glGetStringi" );
+		GLint i, count = 0;
+		if( NULL == get_stringi )
+		{
+			return 0;
+		}
+		glGetIntegerv( GL_NUM_EXTENSIONS, &count );
+		for( i = 0; i < count; ++i )
+		{
+			const char *extension = (const char*)get_stringi( GL_EXTENSIONS, (GLuint)i );
+			if( (NULL != extension) && (0 == strcmp( extension, name )) )
+			{
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+/*	finds glCompressedTexImage2D (core since 1.3, the ARB entry point before), returns 0 if there is none	*/
+static int SOIL_load_compressed_upload( void )
+{
+	P_SOIL_GLCOMPRESSEDTEXIMAGE2DPROC ext_addr = NULL;
+	if( NULL != soilGlCompressedTexImage2D )
+	{
+		return 1;
+	}
+	if( SOIL_GL_version_at_least( 1, 3 ) )
+	{
+		ext_addr = (P_SOIL_GLCOMPRESSEDTEXIMAGE2DPROC)
+				SOIL_GL_proc_address( "glCompressedTexImage2D" );
+	}
+	if( NULL == ext_addr )
+	{
+		ext_addr = (P_SOIL_GLCOMPRESSEDTEXIMAGE2DPROC)
+				SOIL_GL_proc_address( "glCompressedTexImage2DARB" );
+	}
+	/*	hmm, not good!!  This should not happen, but does on my
+		laptop's VIA chipset.  The GL_EXT_texture_compression_s3tc
+		spec requires that ARB_texture_compression be present too.
+		this means I can upload and have the OpenGL drive do the
+		conversion, but I can't use my own routines or load DDS files
+		from disk and upload them directly [8^(	*/
+	soilGlCompressedTexImage2D = ext_addr;
+	return (NULL != ext_addr);
+}
+
 int query_NPOT_capability( void )
 {
 	/*	check for the capability	*/
 	if( has_NPOT_capability == SOIL_CAPABILITY_UNKNOWN )
 	{
-		/*	we haven't yet checked for the capability, do so	*/
+		/*	we haven't yet checked for the capability, do so (core since 2.0)	*/
 		if(
-			(NULL == strstr( (char const*)glGetString( GL_EXTENSIONS ),
-				"GL_ARB_texture_non_power_of_two" ) )
+			!SOIL_GL_version_at_least( 2, 0 ) &&
+			!SOIL_has_extension( "GL_ARB_texture_non_power_of_two" )
 			)
 		{
 			/*	not there, flag the failure	*/
@@ -1898,16 +2081,12 @@ int query_tex_rectangle_capability( void )
 	/*	check for the capability	*/
 	if( has_tex_rectangle_capability == SOIL_CAPABILITY_UNKNOWN )
 	{
-		/*	we haven't yet checked for the capability, do so	*/
+		/*	we haven't yet checked for the capability, do so (core since 3.1)	*/
 		if(
-			(NULL == strstr( (char const*)glGetString( GL_EXTENSIONS ),
-				"GL_ARB_texture_rectangle" ) )
-		&&
-			(NULL == strstr( (char const*)glGetString( GL_EXTENSIONS ),
-				"GL_EXT_texture_rectangle" ) )
-		&&
-			(NULL == strstr( (char const*)glGetString( GL_EXTENSIONS ),
-				"GL_NV_texture_rectangle" ) )
+			!SOIL_GL_version_at_least( 3, 1 ) &&
+			!SOIL_has_extension( "GL_ARB_texture_rectangle" ) &&
+			!SOIL_has_extension( "GL_EXT_texture_rectangle" ) &&
+			!SOIL_has_extension( "GL_NV_texture_rectangle" )
 			)
 		{
 			/*	not there, flag the failure	*/
@@ -1927,13 +2106,11 @@ int query_cubemap_capability( void )
 	/*	check for the capability	*/
 	if( has_cubemap_capability == SOIL_CAPABILITY_UNKNOWN )
 	{
-		/*	we haven't yet checked for the capability, do so	*/
+		/*	we haven't yet checked for the capability, do so (core since 1.3)	*/
 		if(
-			(NULL == strstr( (char const*)glGetString( GL_EXTENSIONS ),
-				"GL_ARB_texture_cube_map" ) )
-		&&
-			(NULL == strstr( (char const*)glGetString( GL_EXTENSIONS ),
-				"GL_EXT_texture_cube_map" ) )
+			!SOIL_GL_version_at_least( 1, 3 ) &&
+			!SOIL_has_extension( "GL_ARB_texture_cube_map" ) &&
+			!SOIL_has_extension( "GL_EXT_texture_cube_map" )
 			)
 		{
 			/*	not there, flag the failure	*/
@@ -1948,75 +2125,58 @@ int query_cubemap_capability( void )
 	return has_cubemap_capability;
 }
 
+int query_RGTC_capability( void )
+{
+	/*	check for the capability, core since 3.0	*/
+	if( has_RGTC_capability == SOIL_CAPABILITY_UNKNOWN )
+	{
+		if( (SOIL_GL_version_at_least( 3, 0 ) ||
+			SOIL_has_extension( "GL_ARB_texture_compression_rgtc" ) ||
+			SOIL_has_extension( "GL_EXT_texture_compression_rgtc" )) &&
+			SOIL_load_compressed_upload() )
+		{
+			has_RGTC_capability = SOIL_CAPABILITY_PRESENT;
+		} else
+		{
+			has_RGTC_capability = SOIL_CAPABILITY_NONE;
+		}
+	}
+	return has_RGTC_capability;
+}
+
+int query_BPTC_capability( void )
+{
+	/*	check for the capability, core since 4.2	*/
+	if( has_BPTC_capability == SOIL_CAPABILITY_UNKNOWN )
+	{
+		if( (SOIL_GL_version_at_least( 4, 2 ) ||
+			SOIL_has_extension( "GL_ARB_texture_compression_bptc" )) &&
+			SOIL_load_compressed_upload() )
+		{
+			has_BPTC_capability = SOIL_CAPABILITY_PRESENT;
+		} else
+		{
+			has_BPTC_capability = SOIL_CAPABILITY_NONE;
+		}
+	}
+	return has_BPTC_capability;
+}
+
 int query_DXT_capability( void )
 {
 	/*	check for the capability	*/
 	if( has_DXT_capability == SOIL_CAPABILITY_UNKNOWN )
 	{
-		/*	we haven't yet checked for the capability, do so	*/
-		if( NULL == strstr(
-				(char const*)glGetString( GL_EXTENSIONS ),
-				"GL_EXT_texture_compression_s3tc" ) )
+		/*	we haven't yet checked for the capability, do so (S3TC never became core)	*/
+		if( SOIL_has_extension( "GL_EXT_texture_compression_s3tc" ) &&
+			SOIL_load_compressed_upload() )
 		{
-			/*	not there, flag the failure	*/
-			has_DXT_capability = SOIL_CAPABILITY_NONE;
+			/*	all's well!	*/
+			has_DXT_capability = SOIL_CAPABILITY_PRESENT;
 		} else
 		{
-			/*	and find the address of the extension function	*/
-			P_SOIL_GLCOMPRESSEDTEXIMAGE2DPROC ext_addr = NULL;
-			#ifdef WIN32
-				ext_addr = (P_SOIL_GLCOMPRESSEDTEXIMAGE2DPROC)
-						wglGetProcAddress
-						(
-							"glCompressedTexImage2DARB"
-						);
-			#elif defined(__APPLE__) || defined(__APPLE_CC__)
-				/*	I can't test this Apple stuff!	*/
-				CFBundleRef bundle;
-				CFURLRef bundleURL =
-					CFURLCreateWithFileSystemPath(
-						kCFAllocatorDefault,
-						CFSTR("/System/Library/Frameworks/OpenGL.framework"),
-						kCFURLPOSIXPathStyle,
-						true );
-				CFStringRef extensionName =
-					CFStringCreateWithCString(
-						kCFAllocatorDefault,
-						"glCompressedTexImage2DARB",
-						kCFStringEncodingASCII );
-				bundle = CFBundleCreate( kCFAllocatorDefault, bundleURL );
-				assert( bundle != NULL );
-				ext_addr = (P_SOIL_GLCOMPRESSEDTEXIMAGE2DPROC)
-						CFBundleGetFunctionPointerForName
-						(
-							bundle, extensionName
-						);
-				CFRelease( bundleURL );
-				CFRelease( extensionName );
-				CFRelease( bundle );
-			#else
-				ext_addr = (P_SOIL_GLCOMPRESSEDTEXIMAGE2DPROC)
-						glXGetProcAddressARB
-						(
-							(const GLubyte *)"glCompressedTexImage2DARB"
-						);
-			#endif
-			/*	Flag it so no checks needed later	*/
-			if( NULL == ext_addr )
-			{
-				/*	hmm, not good!!  This should not happen, but does on my
-					laptop's VIA chipset.  The GL_EXT_texture_compression_s3tc
-					spec requires that ARB_texture_compression be present too.
-					this means I can upload and have the OpenGL drive do the
-					conversion, but I can't use my own routines or load DDS files
-					from disk and upload them directly [8^(	*/
-				has_DXT_capability = SOIL_CAPABILITY_NONE;
-			} else
-			{
-				/*	all's well!	*/
-				soilGlCompressedTexImage2D = ext_addr;
-				has_DXT_capability = SOIL_CAPABILITY_PRESENT;
-			}
+			/*	not there, flag the failure	*/
+			has_DXT_capability = SOIL_CAPABILITY_NONE;
 		}
 	}
 	/*	let the user know if we can do DXT or not	*/
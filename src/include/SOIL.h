@@ -91,6 +91,10 @@ enum
 	SOIL_FLAG_NTSC_SAFE_RGB: clamps RGB components to the range [16,235]
 	SOIL_FLAG_CoCg_Y: Google YCoCg; RGB=>CoYCg, RGBA=>CoCgAY
 	SOIL_FLAG_TEXTURE_RECTANGE: uses ARB_texture_rectangle ; pixel indexed & no repeat or MIPmaps or cubemaps
+	SOIL_FLAG_SCALAR_MAP: with SOIL_FLAG_COMPRESS_TO_DXT, red only data (metallic, roughness, ao) goes to BC4 if the card has RGTC
+	SOIL_FLAG_NORMAL_MAP: with SOIL_FLAG_COMPRESS_TO_DXT, keeps x,y of a tangent space normal map in BC5 if the card has RGTC (rebuild z in the shader); MIPmaps are renormalized
+	SOIL_FLAG_ALBEDO_MAP: with SOIL_FLAG_COMPRESS_TO_DXT, color goes to BC7 if the card has BPTC; MIPmaps are filtered in linear space
+	SOIL_FLAG_ALPHA_COVERAGE: MIPmaps keep the fraction of texels passing an alpha test at 0.5 (alpha tested cutouts); images without alpha are taken as the mask
 **/
 enum
 {
@@ -103,7 +107,11 @@ enum
 	SOIL_FLAG_DDS_LOAD_DIRECT = 64,
 	SOIL_FLAG_NTSC_SAFE_RGB = 128,
 	SOIL_FLAG_CoCg_Y = 256,
-	SOIL_FLAG_TEXTURE_RECTANGLE = 512
+	SOIL_FLAG_TEXTURE_RECTANGLE = 512,
+	SOIL_FLAG_SCALAR_MAP = 1024,
+	SOIL_FLAG_NORMAL_MAP = 2048,
+	SOIL_FLAG_ALBEDO_MAP = 4096,
+	SOIL_FLAG_ALPHA_COVERAGE = 8192
 };
 
 /**
@@ -19,6 +19,18 @@
 	method fails for finding the largest eigenvector	*/
 #define USE_COV_MAT	1
 
+/*	the block encoders below work on DXT_SIMD_BLOCKS blocks at once,
+	one block per SIMD lane (only the covariance method is vectorized)	*/
+#if USE_COV_MAT && defined(__AVX2__)
+	#include <immintrin.h>
+	#define DXT_SIMD_BLOCKS	8
+#elif USE_COV_MAT && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#include <emmintrin.h>
+	#define DXT_SIMD_BLOCKS	4
+#else
+	#define DXT_SIMD_BLOCKS	1
+#endif
+
 /********* Function Prototypes *********/
 /*
 	Takes a 4x4 block of pixels and compresses it into 8 bytes
@@ -37,6 +49,45 @@ void compress_DDS_color_block(
 void compress_DDS_alpha_block(
 				const unsigned char *const uncompressed,
 				unsigned char compressed[8] );
+/*
+	Compresses the color of count (<= DXT_SIMD_BLOCKS) 4x4 RGBA
+	blocks stored one after the other (64 bytes each), giving the
+	same 8 bytes as compress_DDS_color_block for each.  Block k is
+	written to compressed + k*stride.
+*/
+void compress_DDS_color_blocks(
+				int count,
+				const unsigned char *const uncompressed,
+				unsigned char *compressed, int stride );
+int rgb_to_565( int r, int g, int b );
+void rgb_888_from_565( unsigned int c, int *r, int *g, int *b );
+/*
+	Compresses 16 single channel values into an 8 byte BC4 block
+	(the same layout as the DXT5 alpha block), trying both the
+	8 value and the 6 value + 0/255 palettes and keeping the better.
+*/
+void compress_BC4_block(
+				const unsigned char values[16],
+				unsigned char compressed[8] );
+/*
+	Compresses a 4x4 RGBA block into a 16 byte BC7 mode 6 block:
+	one subset, RGBA endpoints of 7 bits plus a p-bit each and
+	4 bit indices.
+*/
+void compress_BC7_block(
+				const unsigned char *const uncompressed,
+				unsigned char compressed[16] );
+
+/*	the formats the block parallel driver below can write	*/
+enum
+{
+	DXT_FORMAT_DXT1,
+	DXT_FORMAT_DXT5,
+	DXT_FORMAT_BC4,
+	DXT_FORMAT_BC5,
+	DXT_FORMAT_BC7
+};
+static const int DXT_format_block_bytes[] = { 8, 16, 8, 16, 16 };
 
 /********* Actual Exposed Functions *********/
 int
@@ -98,7 +149,7 @@ int
 	return 1;
 }
 
-unsigned char* convert_image_to_DXT1(
+unsigned char* convert_image_to_DXT1_reference(
 		const unsigned char *const uncompressed,
 		int width, int height, int channels,
 		int *out_size )
@@ -179,7 +230,7 @@ unsigned char* convert_image_to_DXT1(
 	return compressed;
 }
 
-unsigned char* convert_image_to_DXT5(
+unsigned char* convert_image_to_DXT5_reference(
 		const unsigned char *const uncompressed,
 		int width, int height, int channels,
 		int *out_size )
@@ -630,3 +681,820 @@ void
 	}
 	/*	done compressing to DXT1	*/
 }
+
+/********* Block Parallel Encoders *********/
+/*
+	Copies the 4x4 block at pixel (i, j) into ublock as RGBA, the same
+	way the reference encoders do: grey images repeat the first channel,
+	images without alpha get 255, and the parts of edge blocks outside
+	the image repeat the block's first pixel.
+*/
+static void gather_DXT_block(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int i, int j,
+		unsigned char ublock[16*4] )
+{
+	int x, y, idx = 0;
+	int mx = 4, my = 4;
+	int chan_step = (channels < 3) ? 0 : 1;
+	int alpha = (channels & 1) ? -1 : channels - 1;
+	if( j+4 >= height )
+	{
+		my = height - j;
+	}
+	if( i+4 >= width )
+	{
+		mx = width - i;
+	}
+	for( y = 0; y < my; ++y )
+	{
+		/*	step through the row with a pointer instead of indexing each pixel	*/
+		const unsigned char *p = uncompressed + ((size_t)(j+y)*width + i)*channels;
+		for( x = 0; x < mx; ++x, p += channels )
+		{
+			ublock[idx++] = p[0];
+			ublock[idx++] = p[chan_step];
+			ublock[idx++] = p[chan_step+chan_step];
+			ublock[idx++] = (alpha < 0) ? 255 : p[alpha];
+		}
+		for( x = mx; x < 4; ++x, idx += 4 )
+		{
+			memcpy( ublock + idx, ublock, 4 );
+		}
+	}
+	for( ; idx < 16*4; idx += 4 )
+	{
+		memcpy( ublock + idx, ublock, 4 );
+	}
+}
+
+/*
+	Encodes one row of blocks, DXT_SIMD_BLOCKS at a time.
+	block_bytes is 8 for DXT1 and 16 for DXT5 (alpha first).
+*/
+static void compress_DXT_block_row(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int j, int block_bytes,
+		unsigned char *compressed )
+{
+	unsigned char ublocks[DXT_SIMD_BLOCKS*16*4];
+	int i, k, count;
+	int color_offset = block_bytes - 8;
+	for( i = 0; i < width; i += 4*count )
+	{
+		count = (width - i + 3) >> 2;
+		if( count > DXT_SIMD_BLOCKS )
+		{
+			count = DXT_SIMD_BLOCKS;
+		}
+		for( k = 0; k < count; ++k )
+		{
+			gather_DXT_block( uncompressed, width, height, channels, i + 4*k, j, ublocks + k*64 );
+			if( color_offset > 0 )
+			{
+				compress_DDS_alpha_block( ublocks + k*64, compressed + k*block_bytes );
+			}
+		}
+		compress_DDS_color_blocks( count, ublocks, compressed + color_offset, block_bytes );
+		compressed += count*block_bytes;
+	}
+}
+
+/*
+	Encodes one row of blocks of the BC formats, one block at a time.
+*/
+static void compress_BC_block_row(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int j, int format,
+		unsigned char *compressed )
+{
+	unsigned char ublock[16*4];
+	unsigned char values[16];
+	int i, k, c;
+	for( i = 0; i < width; i += 4 )
+	{
+		gather_DXT_block( uncompressed, width, height, channels, i, j, ublock );
+		if( format == DXT_FORMAT_BC7 )
+		{
+			compress_BC7_block( ublock, compressed );
+			compressed += 16;
+			continue;
+		}
+		/*	BC4 is red only, BC5 is a BC4 block for red and one for green	*/
+		for( c = 0; c < ((format == DXT_FORMAT_BC5) ? 2 : 1); ++c )
+		{
+			for( k = 0; k < 16; ++k )
+			{
+				values[k] = ublock[k*4+c];
+			}
+			compress_BC4_block( values, compressed );
+			compressed += 8;
+		}
+	}
+}
+
+static unsigned char* convert_image_to_DXT(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int format,
+		int *out_size )
+{
+	unsigned char *compressed;
+	int row, rows, row_bytes;
+	int block_bytes = DXT_format_block_bytes[format];
+	/*	error check	*/
+	*out_size = 0;
+	if( (width < 1) || (height < 1) ||
+		(NULL == uncompressed) ||
+		(channels < 1) || (channels > 4) )
+	{
+		return NULL;
+	}
+	rows = (height+3) >> 2;
+	row_bytes = ((width+3) >> 2) * block_bytes;
+	*out_size = rows * row_bytes;
+	compressed = (unsigned char*)malloc( *out_size );
+	if( NULL == compressed )
+	{
+		*out_size = 0;
+		return NULL;
+	}
+	/*	every block row writes its own part of the output, so the rows
+		can be handed out to threads in bands	*/
+	#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic, 4)
+	#endif
+	for( row = 0; row < rows; ++row )
+	{
+		if( format <= DXT_FORMAT_DXT5 )
+		{
+			compress_DXT_block_row( uncompressed, width, height, channels,
+					row*4, block_bytes, compressed + (size_t)row*row_bytes );
+		} else
+		{
+			compress_BC_block_row( uncompressed, width, height, channels,
+					row*4, format, compressed + (size_t)row*row_bytes );
+		}
+	}
+	return compressed;
+}
+
+unsigned char* convert_image_to_DXT1(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int *out_size )
+{
+	return convert_image_to_DXT( uncompressed, width, height, channels, DXT_FORMAT_DXT1, out_size );
+}
+
+unsigned char* convert_image_to_DXT5(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int *out_size )
+{
+	return convert_image_to_DXT( uncompressed, width, height, channels, DXT_FORMAT_DXT5, out_size );
+}
+
+unsigned char* convert_image_to_BC4(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int *out_size )
+{
+	return convert_image_to_DXT( uncompressed, width, height, channels, DXT_FORMAT_BC4, out_size );
+}
+
+unsigned char* convert_image_to_BC5(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int *out_size )
+{
+	return convert_image_to_DXT( uncompressed, width, height, channels, DXT_FORMAT_BC5, out_size );
+}
+
+unsigned char* convert_image_to_BC7(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int *out_size )
+{
+	return convert_image_to_DXT( uncompressed, width, height, channels, DXT_FORMAT_BC7, out_size );
+}
+
+#if DXT_SIMD_BLOCKS == 8
+	typedef __m256 dxt_vf;
+	typedef __m256i dxt_vi;
+	#define dxt_loadf	_mm256_loadu_ps
+	#define dxt_storef	_mm256_storeu_ps
+	#define dxt_set1f	_mm256_set1_ps
+	#define dxt_addf	_mm256_add_ps
+	#define dxt_subf	_mm256_sub_ps
+	#define dxt_mulf	_mm256_mul_ps
+	#define dxt_divf	_mm256_div_ps
+	#define dxt_minf	_mm256_min_ps
+	#define dxt_maxf	_mm256_max_ps
+	#define dxt_cvttf	_mm256_cvttps_epi32
+	#define dxt_storei(p, v)	_mm256_storeu_si256( (__m256i*)(p), v )
+	#define dxt_set1i	_mm256_set1_epi32
+	#define dxt_zeroi	_mm256_setzero_si256
+	#define dxt_addi	_mm256_add_epi32
+	#define dxt_subi	_mm256_sub_epi32
+	#define dxt_andi	_mm256_and_si256
+	#define dxt_ori	_mm256_or_si256
+	#define dxt_cmpeqi	_mm256_cmpeq_epi32
+	#define dxt_slli(v, n)	_mm256_sll_epi32( v, _mm_cvtsi32_si128( n ) )
+#elif DXT_SIMD_BLOCKS == 4
+	typedef __m128 dxt_vf;
+	typedef __m128i dxt_vi;
+	#define dxt_loadf	_mm_loadu_ps
+	#define dxt_storef	_mm_storeu_ps
+	#define dxt_set1f	_mm_set1_ps
+	#define dxt_addf	_mm_add_ps
+	#define dxt_subf	_mm_sub_ps
+	#define dxt_mulf	_mm_mul_ps
+	#define dxt_divf	_mm_div_ps
+	#define dxt_minf	_mm_min_ps
+	#define dxt_maxf	_mm_max_ps
+	#define dxt_cvttf	_mm_cvttps_epi32
+	#define dxt_storei(p, v)	_mm_storeu_si128( (__m128i*)(p), v )
+	#define dxt_set1i	_mm_set1_epi32
+	#define dxt_zeroi	_mm_setzero_si128
+	#define dxt_addi	_mm_add_epi32
+	#define dxt_subi	_mm_sub_epi32
+	#define dxt_andi	_mm_and_si128
+	#define dxt_ori	_mm_or_si128
+	#define dxt_cmpeqi	_mm_cmpeq_epi32
+	#define dxt_slli(v, n)	_mm_sll_epi32( v, _mm_cvtsi32_si128( n ) )
+#endif
+
+#if DXT_SIMD_BLOCKS > 1
+/*	((a*x + b*y) + c*z), in the same order as the scalar code	*/
+#define dxt_dot3(a, b, c, x, y, z)	\
+	dxt_addf( dxt_addf( dxt_mulf( a, x ), dxt_mulf( b, y ) ), dxt_mulf( c, z ) )
+
+/*
+	compress_DDS_color_block for DXT_SIMD_BLOCKS blocks, one per lane.
+	Every float operation mirrors the scalar code in the same order, so
+	the results are identical.  The pixel sums are exact in float (at
+	most 16*255*255 < 2^24), so their order does not matter.
+*/
+void
+	compress_DDS_color_blocks
+	(
+		int count,
+		const unsigned char *const uncompressed,
+		unsigned char *compressed, int stride
+	)
+{
+	float rgb[3][16][DXT_SIMD_BLOCKS];
+	float line[4][DXT_SIMD_BLOCKS];
+	int master[2][3][DXT_SIMD_BLOCKS];
+	unsigned int bits[DXT_SIMD_BLOCKS];
+	dxt_vf r[16], g[16], b[16];
+	dxt_vf sum_r, sum_g, sum_b, sum_rr, sum_gg, sum_bb, sum_rg, sum_rb, sum_gb;
+	dxt_vf dir_r, dir_g, dir_b, vec_len2, dot, dot_min, dot_max;
+	dxt_vf line_r, line_g, line_b, dot_offset;
+	dxt_vf zero = dxt_set1f( 0.0f );
+	dxt_vi packed, value, swizzled;
+	int i, k, c, iteration;
+	/*	transpose to one vector per pixel and channel, unused lanes repeat block 0	*/
+	for( k = 0; k < DXT_SIMD_BLOCKS; ++k )
+	{
+		const unsigned char *block = uncompressed + ((k < count) ? k : 0)*64;
+		for( i = 0; i < 16; ++i )
+		{
+			rgb[0][i][k] = block[i*4+0];
+			rgb[1][i][k] = block[i*4+1];
+			rgb[2][i][k] = block[i*4+2];
+		}
+	}
+	sum_r = sum_g = sum_b = zero;
+	sum_rr = sum_gg = sum_bb = sum_rg = sum_rb = sum_gb = zero;
+	for( i = 0; i < 16; ++i )
+	{
+		r[i] = dxt_loadf( rgb[0][i] );
+		g[i] = dxt_loadf( rgb[1][i] );
+		b[i] = dxt_loadf( rgb[2][i] );
+		sum_r = dxt_addf( sum_r, r[i] );
+		sum_g = dxt_addf( sum_g, g[i] );
+		sum_b = dxt_addf( sum_b, b[i] );
+		sum_rr = dxt_addf( sum_rr, dxt_mulf( r[i], r[i] ) );
+		sum_gg = dxt_addf( sum_gg, dxt_mulf( g[i], g[i] ) );
+		sum_bb = dxt_addf( sum_bb, dxt_mulf( b[i], b[i] ) );
+		sum_rg = dxt_addf( sum_rg, dxt_mulf( r[i], g[i] ) );
+		sum_rb = dxt_addf( sum_rb, dxt_mulf( r[i], b[i] ) );
+		sum_gb = dxt_addf( sum_gb, dxt_mulf( g[i], b[i] ) );
+	}
+	/*	compute_color_line_STDEV: averages and the covariance matrix	*/
+	sum_r = dxt_mulf( sum_r, dxt_set1f( 1.0f / 16.0f ) );
+	sum_g = dxt_mulf( sum_g, dxt_set1f( 1.0f / 16.0f ) );
+	sum_b = dxt_mulf( sum_b, dxt_set1f( 1.0f / 16.0f ) );
+	sum_rr = dxt_subf( sum_rr, dxt_mulf( dxt_mulf( dxt_set1f( 16.0f ), sum_r ), sum_r ) );
+	sum_gg = dxt_subf( sum_gg, dxt_mulf( dxt_mulf( dxt_set1f( 16.0f ), sum_g ), sum_g ) );
+	sum_bb = dxt_subf( sum_bb, dxt_mulf( dxt_mulf( dxt_set1f( 16.0f ), sum_b ), sum_b ) );
+	sum_rg = dxt_subf( sum_rg, dxt_mulf( dxt_mulf( dxt_set1f( 16.0f ), sum_r ), sum_g ) );
+	sum_rb = dxt_subf( sum_rb, dxt_mulf( dxt_mulf( dxt_set1f( 16.0f ), sum_r ), sum_b ) );
+	sum_gb = dxt_subf( sum_gb, dxt_mulf( dxt_mulf( dxt_set1f( 16.0f ), sum_g ), sum_b ) );
+	/*	three power method iterations for the largest eigenvector	*/
+	dir_r = dxt_set1f( 1.0f );
+	dir_g = dxt_set1f( 2.718281828f );
+	dir_b = dxt_set1f( 3.141592654f );
+	for( iteration = 0; iteration < 3; ++iteration )
+	{
+		dxt_vf next_r = dxt_dot3( dir_r, dir_g, dir_b, sum_rr, sum_rg, sum_rb );
+		dxt_vf next_g = dxt_dot3( dir_r, dir_g, dir_b, sum_rg, sum_gg, sum_gb );
+		dxt_vf next_b = dxt_dot3( dir_r, dir_g, dir_b, sum_rb, sum_gb, sum_bb );
+		dir_r = next_r;
+		dir_g = next_g;
+		dir_b = next_b;
+	}
+	/*	LSE_master_colors_max_min: extent of the block along the line	*/
+	vec_len2 = dxt_divf( dxt_set1f( 1.0f ), dxt_addf( dxt_addf( dxt_addf( dxt_set1f( 0.00001f ),
+			dxt_mulf( dir_r, dir_r ) ), dxt_mulf( dir_g, dir_g ) ), dxt_mulf( dir_b, dir_b ) ) );
+	dot_min = dot_max = dxt_dot3( dir_r, dir_g, dir_b, r[0], g[0], b[0] );
+	for( i = 1; i < 16; ++i )
+	{
+		dot = dxt_dot3( dir_r, dir_g, dir_b, r[i], g[i], b[i] );
+		dot_min = dxt_minf( dot_min, dot );
+		dot_max = dxt_maxf( dot_max, dot );
+	}
+	dot = dxt_dot3( dir_r, dir_g, dir_b, sum_r, sum_g, sum_b );
+	dot_min = dxt_mulf( dxt_subf( dot_min, dot ), vec_len2 );
+	dot_max = dxt_mulf( dxt_subf( dot_max, dot ), vec_len2 );
+	/*	the master colors, clamping before the truncation gives the same result	*/
+	{
+		dxt_vf average[3], direction[3];
+		average[0] = sum_r; average[1] = sum_g; average[2] = sum_b;
+		direction[0] = dir_r; direction[1] = dir_g; direction[2] = dir_b;
+		for( c = 0; c < 3; ++c )
+		{
+			dxt_vf c0 = dxt_addf( dxt_addf( dxt_set1f( 0.5f ), average[c] ), dxt_mulf( dot_max, direction[c] ) );
+			dxt_vf c1 = dxt_addf( dxt_addf( dxt_set1f( 0.5f ), average[c] ), dxt_mulf( dot_min, direction[c] ) );
+			c0 = dxt_minf( dxt_maxf( c0, zero ), dxt_set1f( 255.0f ) );
+			c1 = dxt_minf( dxt_maxf( c1, zero ), dxt_set1f( 255.0f ) );
+			dxt_storei( master[0][c], dxt_cvttf( c0 ) );
+			dxt_storei( master[1][c], dxt_cvttf( c1 ) );
+		}
+	}
+	/*	the 565 endpoints and the scaled line between them are per block	*/
+	for( k = 0; k < DXT_SIMD_BLOCKS; ++k )
+	{
+		int enc_c0, enc_c1, c0[3], c1[3];
+		float len2 = 0.0f;
+		enc_c0 = rgb_to_565( master[0][0][k], master[0][1][k], master[0][2][k] );
+		enc_c1 = rgb_to_565( master[1][0][k], master[1][1][k], master[1][2][k] );
+		if( enc_c0 < enc_c1 )
+		{
+			int swap = enc_c0;
+			enc_c0 = enc_c1;
+			enc_c1 = swap;
+		}
+		if( k < count )
+		{
+			unsigned char *out = compressed + k*stride;
+			out[0] = (enc_c0 >> 0) & 255;
+			out[1] = (enc_c0 >> 8) & 255;
+			out[2] = (enc_c1 >> 0) & 255;
+			out[3] = (enc_c1 >> 8) & 255;
+		}
+		rgb_888_from_565( enc_c0, &c0[0], &c0[1], &c0[2] );
+		rgb_888_from_565( enc_c1, &c1[0], &c1[1], &c1[2] );
+		for( c = 0; c < 3; ++c )
+		{
+			line[c][k] = (float)(c1[c] - c0[c]);
+			len2 += line[c][k] * line[c][k];
+		}
+		if( len2 > 0.0f )
+		{
+			len2 = 1.0f / len2;
+		}
+		line[0][k] *= len2;
+		line[1][k] *= len2;
+		line[2][k] *= len2;
+		line[3][k] = line[0][k]*c0[0] + line[1][k]*c0[1] + line[2][k]*c0[2];
+	}
+	/*	place every pixel on the line and pack the 2 bit indices	*/
+	line_r = dxt_loadf( line[0] );
+	line_g = dxt_loadf( line[1] );
+	line_b = dxt_loadf( line[2] );
+	dot_offset = dxt_loadf( line[3] );
+	packed = dxt_zeroi();
+	for( i = 0; i < 16; ++i )
+	{
+		dot = dxt_subf( dxt_dot3( line_r, line_g, line_b, r[i], g[i], b[i] ), dot_offset );
+		dot = dxt_addf( dxt_mulf( dot, dxt_set1f( 3.0f ) ), dxt_set1f( 0.5f ) );
+		value = dxt_cvttf( dxt_minf( dxt_maxf( dot, zero ), dxt_set1f( 3.0f ) ) );
+		/*	stupid order { 0, 2, 3, 1 }: v + 1, minus 1 for 0 and minus 3 for 3	*/
+		swizzled = dxt_subi( dxt_addi( value, dxt_set1i( 1 ) ),
+				dxt_andi( dxt_cmpeqi( value, dxt_zeroi() ), dxt_set1i( 1 ) ) );
+		swizzled = dxt_subi( swizzled, dxt_andi( dxt_cmpeqi( value, dxt_set1i( 3 ) ), dxt_set1i( 3 ) ) );
+		packed = dxt_ori( packed, dxt_slli( swizzled, 2*i ) );
+	}
+	dxt_storei( bits, packed );
+	for( k = 0; k < count; ++k )
+	{
+		unsigned char *out = compressed + k*stride;
+		out[4] = (bits[k] >> 0) & 255;
+		out[5] = (bits[k] >> 8) & 255;
+		out[6] = (bits[k] >> 16) & 255;
+		out[7] = (bits[k] >> 24) & 255;
+	}
+}
+#else
+void
+	compress_DDS_color_blocks
+	(
+		int count,
+		const unsigned char *const uncompressed,
+		unsigned char *compressed, int stride
+	)
+{
+	int k;
+	for( k = 0; k < count; ++k )
+	{
+		compress_DDS_color_block( 4, uncompressed + k*64, compressed + k*stride );
+	}
+}
+#endif
+
+/********* BC4 / BC5 / BC7 Block Encoders *********/
+/*
+	Picks the closest of the 8 palette entries for every value, writes
+	the 3 bit indices and returns the summed squared error.
+*/
+static int fit_BC4_palette(
+		const unsigned char values[16],
+		const int palette[8],
+		unsigned char compressed[8],
+		int indices[16] )
+{
+	int i, k, error = 0;
+	int next_bit = 8*2;
+	memset( compressed + 2, 0, 6 );
+	for( i = 0; i < 16; ++i )
+	{
+		int best = 0, best_error = 256*256;
+		for( k = 0; k < 8; ++k )
+		{
+			int d = values[i] - palette[k];
+			if( d*d < best_error )
+			{
+				best_error = d*d;
+				best = k;
+			}
+		}
+		error += best_error;
+		indices[i] = best;
+		compressed[next_bit >> 3] |= best << (next_bit & 7);
+		if( (next_bit & 7) > 5 )
+		{
+			/*	spans 2 bytes	*/
+			compressed[1 + (next_bit >> 3)] |= best >> (8 - (next_bit & 7));
+		}
+		next_bit += 3;
+	}
+	return error;
+}
+
+void
+	compress_BC4_block
+	(
+		const unsigned char values[16],
+		unsigned char compressed[8]
+	)
+{
+	int i, lo = 255, hi = 0, inner_lo = 255, inner_hi = 0;
+	int palette[8], indices[16];
+	unsigned char trial[8];
+	int error, iteration;
+	for( i = 0; i < 16; ++i )
+	{
+		int v = values[i];
+		if( v < lo ) lo = v;
+		if( v > hi ) hi = v;
+		if( (v > 0) && (v < 255) )
+		{
+			if( v < inner_lo ) inner_lo = v;
+			if( v > inner_hi ) inner_hi = v;
+		}
+	}
+	/*	r0 > r1: the endpoints and 6 values in between, starting from the
+		value range and then moved by least squares on the chosen indices	*/
+	compressed[0] = hi;
+	compressed[1] = lo;
+	error = 256*256*16;
+	for( iteration = 0; iteration < 3; ++iteration )
+	{
+		float a = 0.0f, b = 0.0f, d = 0.0f, x0 = 0.0f, x1 = 0.0f, det;
+		int r0, r1, trial_error;
+		palette[0] = hi;
+		palette[1] = lo;
+		for( i = 1; i < 7; ++i )
+		{
+			palette[i+1] = ((7-i)*hi + i*lo + 3) / 7;
+		}
+		trial[0] = hi;
+		trial[1] = lo;
+		trial_error = fit_BC4_palette( values, palette, trial, indices );
+		if( trial_error >= error )
+		{
+			break;
+		}
+		error = trial_error;
+		memcpy( compressed, trial, 8 );
+		if( (error == 0) || (hi == lo) )
+		{
+			break;
+		}
+		/*	index 0 is r0, 1 is r1 and 2..7 are 1/7 .. 6/7 of the way to r1	*/
+		for( i = 0; i < 16; ++i )
+		{
+			float w = (indices[i] < 2) ? (float)indices[i] : (indices[i] - 1) * (1.0f / 7.0f);
+			a += (1.0f - w) * (1.0f - w);
+			b += (1.0f - w) * w;
+			d += w * w;
+			x0 += (1.0f - w) * values[i];
+			x1 += w * values[i];
+		}
+		det = a*d - b*b;
+		if( fabs( det ) < 1.0e-6f )
+		{
+			break;
+		}
+		r0 = (int)floor( (d*x0 - b*x1) / det + 0.5f );
+		r1 = (int)floor( (a*x1 - b*x0) / det + 0.5f );
+		hi = (r0 > 255) ? 255 : r0;
+		lo = (r1 < 0) ? 0 : r1;
+		if( hi <= lo )
+		{
+			break;
+		}
+	}
+	/*	r0 <= r1: 4 values in between plus exact 0 and 255,
+		worth a try when the block has both extremes and shades	*/
+	if( (error > 0) && ((lo == 0) || (hi == 255)) )
+	{
+		if( inner_lo > inner_hi )
+		{
+			inner_lo = inner_hi = 0;
+		}
+		palette[0] = inner_lo;
+		palette[1] = inner_hi;
+		for( i = 1; i < 5; ++i )
+		{
+			palette[i+1] = ((5-i)*inner_lo + i*inner_hi + 2) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+		trial[0] = inner_lo;
+		trial[1] = inner_hi;
+		if( fit_BC4_palette( values, palette, trial, indices ) < error )
+		{
+			memcpy( compressed, trial, 8 );
+		}
+	}
+}
+
+/*	BC7 4 bit index weights, out of 64	*/
+static const int BC7_weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+/*
+	Quantizes an RGBA endpoint to 7 bits plus a shared p-bit, trying both
+	p-bits.  Returns the p-bit, q gets the 7 bit values.
+*/
+static int quantize_BC7_endpoint( const float e[4], int q[4] )
+{
+	int p, c, best_p = 0;
+	float best_error = 1.0e30f;
+	for( p = 0; p < 2; ++p )
+	{
+		float error = 0.0f;
+		int t[4];
+		for( c = 0; c < 4; ++c )
+		{
+			float d;
+			t[c] = (int)floor( (e[c] - p) * 0.5f + 0.5f );
+			if( t[c] < 0 ) t[c] = 0;
+			if( t[c] > 127 ) t[c] = 127;
+			d = (float)((t[c] << 1) | p) - e[c];
+			error += d*d;
+		}
+		if( error < best_error )
+		{
+			best_error = error;
+			best_p = p;
+			memcpy( q, t, sizeof( t ) );
+		}
+	}
+	return best_p;
+}
+
+/*
+	Builds the 16 entry palette of a pair of quantized endpoints, picks
+	the closest entry for every pixel and returns the squared error.
+*/
+static int fit_BC7_indices(
+		const unsigned char *const uncompressed,
+		const int q0[4], int p0, const int q1[4], int p1,
+		int indices[16] )
+{
+	int palette[16][4];
+	int i, k, c, error = 0;
+	for( c = 0; c < 4; ++c )
+	{
+		int e0 = (q0[c] << 1) | p0, e1 = (q1[c] << 1) | p1;
+		for( k = 0; k < 16; ++k )
+		{
+			palette[k][c] = ((64 - BC7_weights4[k])*e0 + BC7_weights4[k]*e1 + 32) >> 6;
+		}
+	}
+	for( i = 0; i < 16; ++i )
+	{
+		int best_error = 0x7FFFFFFF;
+		for( k = 0; k < 16; ++k )
+		{
+			int d, e = 0;
+			for( c = 0; c < 4; ++c )
+			{
+				d = uncompressed[i*4+c] - palette[k][c];
+				e += d*d;
+			}
+			if( e < best_error )
+			{
+				best_error = e;
+				indices[i] = k;
+			}
+		}
+		error += best_error;
+	}
+	return error;
+}
+
+static void put_BC7_bits( unsigned char block[16], int *pos, int value, int bits )
+{
+	int i;
+	for( i = 0; i < bits; ++i, ++*pos )
+	{
+		block[*pos >> 3] |= ((value >> i) & 1) << (*pos & 7);
+	}
+}
+
+void
+	compress_BC7_block
+	(
+		const unsigned char *const uncompressed,
+		unsigned char compressed[16]
+	)
+{
+	float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float cov[4][4];
+	float dir[4] = { 1.0f, 2.718281828f, 3.141592654f, 1.414213562f };
+	float e[2][4], t_min = 0.0f, t_max = 0.0f, len2;
+	int q[2][4], p[2], indices[16], best_q[2][4], best_p[2], best_indices[16];
+	int i, c, r, iteration, error, best_error, pos;
+	/*	mean and covariance of the block	*/
+	for( i = 0; i < 16; ++i )
+	{
+		for( c = 0; c < 4; ++c )
+		{
+			mean[c] += uncompressed[i*4+c] * (1.0f / 16.0f);
+		}
+	}
+	memset( cov, 0, sizeof( cov ) );
+	for( i = 0; i < 16; ++i )
+	{
+		float d[4];
+		for( c = 0; c < 4; ++c )
+		{
+			d[c] = uncompressed[i*4+c] - mean[c];
+		}
+		for( r = 0; r < 4; ++r )
+		{
+			for( c = 0; c < 4; ++c )
+			{
+				cov[r][c] += d[r] * d[c];
+			}
+		}
+	}
+	/*	principal axis by the power method (see compute_color_line_STDEV),
+		normalized every step so it can't overflow	*/
+	for( iteration = 0; iteration < 4; ++iteration )
+	{
+		float next[4];
+		len2 = 0.0f;
+		for( r = 0; r < 4; ++r )
+		{
+			next[r] = cov[r][0]*dir[0] + cov[r][1]*dir[1] + cov[r][2]*dir[2] + cov[r][3]*dir[3];
+			len2 += next[r] * next[r];
+		}
+		if( len2 < 1.0e-12f )
+		{
+			break;
+		}
+		len2 = 1.0f / (float)sqrt( len2 );
+		for( r = 0; r < 4; ++r )
+		{
+			dir[r] = next[r] * len2;
+		}
+	}
+	/*	endpoints at the extent of the block along the axis	*/
+	for( i = 0; i < 16; ++i )
+	{
+		float t = 0.0f;
+		for( c = 0; c < 4; ++c )
+		{
+			t += (uncompressed[i*4+c] - mean[c]) * dir[c];
+		}
+		if( (i == 0) || (t < t_min) ) t_min = t;
+		if( (i == 0) || (t > t_max) ) t_max = t;
+	}
+	for( c = 0; c < 4; ++c )
+	{
+		e[0][c] = mean[c] + t_min * dir[c];
+		e[1][c] = mean[c] + t_max * dir[c];
+	}
+	/*	fit, then refine the endpoints once by least squares on the chosen weights	*/
+	best_error = 0x7FFFFFFF;
+	for( iteration = 0; iteration < 2; ++iteration )
+	{
+		for( r = 0; r < 2; ++r )
+		{
+			for( c = 0; c < 4; ++c )
+			{
+				if( e[r][c] < 0.0f ) e[r][c] = 0.0f;
+				if( e[r][c] > 255.0f ) e[r][c] = 255.0f;
+			}
+			p[r] = quantize_BC7_endpoint( e[r], q[r] );
+		}
+		error = fit_BC7_indices( uncompressed, q[0], p[0], q[1], p[1], indices );
+		if( error < best_error )
+		{
+			best_error = error;
+			memcpy( best_q, q, sizeof( q ) );
+			memcpy( best_p, p, sizeof( p ) );
+			memcpy( best_indices, indices, sizeof( indices ) );
+		}
+		if( error == 0 )
+		{
+			break;
+		}
+		{
+			float a = 0.0f, b = 0.0f, d = 0.0f, x0[4] = { 0 }, x1[4] = { 0 }, det;
+			for( i = 0; i < 16; ++i )
+			{
+				float w = BC7_weights4[indices[i]] * (1.0f / 64.0f);
+				a += (1.0f - w) * (1.0f - w);
+				b += (1.0f - w) * w;
+				d += w * w;
+				for( c = 0; c < 4; ++c )
+				{
+					x0[c] += (1.0f - w) * uncompressed[i*4+c];
+					x1[c] += w * uncompressed[i*4+c];
+				}
+			}
+			det = a*d - b*b;
+			if( fabs( det ) < 1.0e-6f )
+			{
+				break;
+			}
+			det = 1.0f / det;
+			for( c = 0; c < 4; ++c )
+			{
+				e[0][c] = (d*x0[c] - b*x1[c]) * det;
+				e[1][c] = (a*x1[c] - b*x0[c]) * det;
+			}
+		}
+	}
+	/*	the anchor (first) index must have its top bit clear,
+		swapping the endpoints mirrors the indices	*/
+	if( best_indices[0] & 8 )
+	{
+		int swap_q[4], swap_p = best_p[0];
+		memcpy( swap_q, best_q[0], sizeof( swap_q ) );
+		memcpy( best_q[0], best_q[1], sizeof( swap_q ) );
+		memcpy( best_q[1], swap_q, sizeof( swap_q ) );
+		best_p[0] = best_p[1];
+		best_p[1] = swap_p;
+		for( i = 0; i < 16; ++i )
+		{
+			best_indices[i] = 15 - best_indices[i];
+		}
+	}
+	/*	mode 6 is 7 bits: 0000001, then R0 R1 G0 G1 B0 B1 A0 A1, P0 P1 and the indices	*/
+	memset( compressed, 0, 16 );
+	pos = 0;
+	put_BC7_bits( compressed, &pos, 1 << 6, 7 );
+	for( c = 0; c < 4; ++c )
+	{
+		put_BC7_bits( compressed, &pos, best_q[0][c], 7 );
+		put_BC7_bits( compressed, &pos, best_q[1][c], 7 );
+	}
+	put_BC7_bits( compressed, &pos, best_p[0], 1 );
+	put_BC7_bits( compressed, &pos, best_p[1], 1 );
+	put_BC7_bits( compressed, &pos, best_indices[0], 3 );
+	for( i = 1; i < 16; ++i )
+	{
+		put_BC7_bits( compressed, &pos, best_indices[i], 4 );
+	}
+}
@@ -10,6 +10,10 @@
 #ifndef HEADER_IMAGE_DXT
 #define HEADER_IMAGE_DXT
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
 	Converts an image from an array of unsigned chars (RGB or RGBA) to
 	DXT1 or DXT5, then saves the converted image to disk.
@@ -45,6 +49,71 @@ convert_image_to_DXT5
     int *out_size
 );
 
+/**
+	take an image and convert it to BC4 (RGTC1, one channel: red,
+	or the grey value), 8 bytes per 4x4 block.  For scalar maps
+	like metallic, roughness or ambient occlusion.
+**/
+unsigned char*
+convert_image_to_BC4
+(
+    const unsigned char *const uncompressed,
+    int width, int height, int channels,
+    int *out_size
+);
+
+/**
+	take an image and convert it to BC5 (RGTC2, red and green), 16 bytes
+	per 4x4 block.  For tangent space normal maps: x and y are kept,
+	the shader rebuilds z = sqrt(1 - x*x - y*y).
+**/
+unsigned char*
+convert_image_to_BC5
+(
+    const unsigned char *const uncompressed,
+    int width, int height, int channels,
+    int *out_size
+);
+
+/**
+	take an image and convert it to BC7 (BPTC unorm), 16 bytes per 4x4
+	block.  Only mode 6 is used (one subset, 7.7.7.7 endpoints with a
+	p-bit each, 4 bit indices), which already beats DXT1 clearly on
+	smooth albedo gradients.
+**/
+unsigned char*
+convert_image_to_BC7
+(
+    const unsigned char *const uncompressed,
+    int width, int height, int channels,
+    int *out_size
+);
+
+/**
+	All the encoders above split the image into bands of block rows,
+	one per thread, when compiled with OpenMP.  DXT1/DXT5 also encode
+	DXT_SIMD_BLOCKS blocks per call with SSE2 (4) or AVX2 (8).  Their output is bit-identical to
+	the one block at a time reference below, as long as the compiler
+	does not contract the reference's float multiply-adds into FMAs
+	(/fp:precise, -ffp-contract=off); with contraction an index may
+	differ by one step for pixels exactly between two palette entries.
+**/
+unsigned char*
+convert_image_to_DXT1_reference
+(
+    const unsigned char *const uncompressed,
+    int width, int height, int channels,
+    int *out_size
+);
+
+unsigned char*
+convert_image_to_DXT5_reference
+(
+    const unsigned char *const uncompressed,
+    int width, int height, int channels,
+    int *out_size
+);
+
 /**	A bunch of DirectDraw Surface structures and flags **/
 typedef struct
 {
@@ -120,4 +189,8 @@ DDS_header ;
 #define DDSCAPS2_CUBEMAP_NEGATIVEZ	0x00008000
 #define DDSCAPS2_VOLUME	0x00200000
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* HEADER_IMAGE_DXT	*/
@@ -8,8 +8,27 @@
 
 #include "image_helper.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+/*	the row kernels of build_mipmap_chain work on MIPMAP_SIMD_FLOATS
+	floats at once: 8 with AVX, 4 with SSE, plain C otherwise	*/
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define MIPMAP_SIMD_FLOATS	8
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define MIPMAP_SIMD_FLOATS	4
+#else
+	#define MIPMAP_SIMD_FLOATS	1
+#endif
+
+/*	build_mipmap_chain filters every texel as 4 floats,
+	whatever the channel count of the image	*/
+#define MIPMAP_TEXEL	4
+/*	alpha test reference used by MIPMAP_ALPHA_COVERAGE	*/
+#define MIPMAP_ALPHA_CUTOFF	0.5f
+
 /*	Upscaling the image uses simple bilinear interpolation	*/
 int
 	up_scale_image
@@ -151,6 +170,498 @@ int
 	return 1;
 }
 
+/*	sin(pi x) / (pi x)	*/
+static float mipmap_sinc( float x )
+{
+	if( fabs( x ) < 1.0e-5f )
+	{
+		return 1.0f;
+	}
+	x *= 3.14159265358979f;
+	return (float)(sin( x ) / x);
+}
+
+/*	modified Bessel function of the first kind, order 0	*/
+static float mipmap_bessel_I0( float x )
+{
+	float sum = 1.0f, term = 1.0f, half = x * 0.5f;
+	int k;
+	for( k = 1; k < 64; ++k )
+	{
+		term *= (half / k) * (half / k);
+		sum += term;
+		if( term < sum * 1.0e-8f )
+		{
+			break;
+		}
+	}
+	return sum;
+}
+
+/*	radius of the filter kernels, in destination texels	*/
+static float mipmap_filter_support( int filter )
+{
+	return (filter == MIPMAP_FILTER_BOX) ? 0.5f : 3.0f;
+}
+
+/*	filter kernels, x in destination texels	*/
+static float mipmap_filter_weight( int filter, float x )
+{
+	float t;
+	x = (float)fabs( x );
+	switch( filter )
+	{
+	case MIPMAP_FILTER_KAISER:
+		/*	Kaiser windowed sinc, width 3, alpha 4	*/
+		if( x >= 3.0f )
+		{
+			return 0.0f;
+		}
+		t = x / 3.0f;
+		return mipmap_sinc( x ) * mipmap_bessel_I0( 4.0f * (float)sqrt( 1.0f - t*t ) ) / mipmap_bessel_I0( 4.0f );
+	case MIPMAP_FILTER_LANCZOS:
+		/*	Lanczos 3	*/
+		if( x >= 3.0f )
+		{
+			return 0.0f;
+		}
+		return mipmap_sinc( x ) * mipmap_sinc( x / 3.0f );
+	default:
+		return (x < 0.5f) ? 1.0f : 0.0f;
+	}
+}
+
+/*	for every destination texel along one axis: the source texels
+	(at most taps) it is made of and their normalized weights	*/
+static void mipmap_build_taps
+	(
+		int src_size, int dst_size,
+		int filter, int wrap, int taps,
+		int *index, float *weight, int *count
+	)
+{
+	float scale = (float)src_size / dst_size;
+	float radius = mipmap_filter_support( filter ) * scale;
+	int d, i;
+	for( d = 0; d < dst_size; ++d )
+	{
+		float center = (d + 0.5f) * scale;
+		int first = (int)floor( center - radius - 0.5f );
+		int last = (int)ceil( center + radius );
+		float sum = 0.0f;
+		int n = 0;
+		for( i = first; (i <= last) && (n < taps); ++i )
+		{
+			float w = mipmap_filter_weight( filter, (i + 0.5f - center) / scale );
+			int s;
+			if( w == 0.0f )
+			{
+				continue;
+			}
+			if( wrap )
+			{
+				s = ((i % src_size) + src_size) % src_size;
+			} else
+			{
+				s = (i < 0) ? 0 : ((i >= src_size) ? src_size - 1 : i);
+			}
+			index[d*taps + n] = s;
+			weight[d*taps + n] = w;
+			sum += w;
+			++n;
+		}
+		for( i = 0; i < n; ++i )
+		{
+			weight[d*taps + i] /= sum;
+		}
+		count[d] = n;
+	}
+}
+
+/*	dst[i] += w * src[i] for n floats	*/
+static void mipmap_row_axpy( float *dst, const float *src, float w, int n, int simd )
+{
+	int i = 0;
+#if MIPMAP_SIMD_FLOATS == 8
+	if( simd )
+	{
+		__m256 vw = _mm256_set1_ps( w );
+		for( ; i + 8 <= n; i += 8 )
+		{
+			_mm256_storeu_ps( dst + i, _mm256_add_ps( _mm256_loadu_ps( dst + i ),
+				_mm256_mul_ps( vw, _mm256_loadu_ps( src + i ) ) ) );
+		}
+	}
+#elif MIPMAP_SIMD_FLOATS == 4
+	if( simd )
+	{
+		__m128 vw = _mm_set1_ps( w );
+		for( ; i + 4 <= n; i += 4 )
+		{
+			_mm_storeu_ps( dst + i, _mm_add_ps( _mm_loadu_ps( dst + i ),
+				_mm_mul_ps( vw, _mm_loadu_ps( src + i ) ) ) );
+		}
+	}
+#endif
+	for( ; i < n; ++i )
+	{
+		dst[i] += w * src[i];
+	}
+}
+
+/*	horizontal pass over one row: each destination texel
+	is the weighted sum of the source texels of its taps	*/
+static void mipmap_filter_row
+	(
+		float *dst, const float *src, int dst_width,
+		int taps, const int *index, const float *weight, const int *count,
+		int simd
+	)
+{
+	int d, k;
+	for( d = 0; d < dst_width; ++d )
+	{
+		const int *tap_index = index + d*taps;
+		const float *tap_weight = weight + d*taps;
+#if MIPMAP_SIMD_FLOATS >= 4
+		if( simd )
+		{
+			/*	one texel per SSE register	*/
+			__m128 sum = _mm_setzero_ps();
+			for( k = 0; k < count[d]; ++k )
+			{
+				sum = _mm_add_ps( sum, _mm_mul_ps( _mm_set1_ps( tap_weight[k] ),
+					_mm_loadu_ps( src + tap_index[k]*MIPMAP_TEXEL ) ) );
+			}
+			_mm_storeu_ps( dst + d*MIPMAP_TEXEL, sum );
+			continue;
+		}
+#endif
+		{
+			float sum[MIPMAP_TEXEL] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			int c;
+			for( k = 0; k < count[d]; ++k )
+			{
+				const float *texel = src + tap_index[k]*MIPMAP_TEXEL;
+				for( c = 0; c < MIPMAP_TEXEL; ++c )
+				{
+					sum[c] += tap_weight[k] * texel[c];
+				}
+			}
+			memcpy( dst + d*MIPMAP_TEXEL, sum, sizeof( sum ) );
+		}
+	}
+}
+
+/*	fraction of the texels passing the alpha test once channel is multiplied by scale	*/
+static float mipmap_coverage( const float *texels, int count, int channel, float scale )
+{
+	int i, covered = 0;
+	for( i = 0; i < count; ++i )
+	{
+		if( texels[i*MIPMAP_TEXEL + channel] * scale > MIPMAP_ALPHA_CUTOFF )
+		{
+			++covered;
+		}
+	}
+	return (float)covered / count;
+}
+
+/*	the alpha scale giving this level the coverage of level 0 (binary search)	*/
+static float mipmap_coverage_scale( const float *texels, int count, int channel, float target )
+{
+	float low = 0.0f, high = 4.0f, best = 1.0f;
+	float best_error = (float)fabs( mipmap_coverage( texels, count, channel, 1.0f ) - target );
+	int k;
+	for( k = 0; (k < 16) && (best_error > 0.0f); ++k )
+	{
+		float middle = 0.5f * (low + high);
+		float coverage = mipmap_coverage( texels, count, channel, middle );
+		float error = (float)fabs( coverage - target );
+		if( error < best_error )
+		{
+			best = middle;
+			best_error = error;
+		}
+		if( coverage < target )
+		{
+			low = middle;
+		} else
+		{
+			high = middle;
+		}
+	}
+	return best;
+}
+
+static unsigned char mipmap_unorm( float v )
+{
+	if( v <= 0.0f )
+	{
+		return 0;
+	}
+	if( v >= 1.0f )
+	{
+		return 255;
+	}
+	return (unsigned char)(v * 255.0f + 0.5f);
+}
+
+static unsigned char mipmap_linear_to_sRGB( float v )
+{
+	if( v <= 0.0031308f )
+	{
+		return mipmap_unorm( v * 12.92f );
+	}
+	return mipmap_unorm( 1.055f * (float)pow( v, 1.0f / 2.4f ) - 0.055f );
+}
+
+/*	converts a filtered level back to channels bytes per texel	*/
+static void mipmap_store_level
+	(
+		const float *texels, int count, int channels, int flags,
+		int alpha_channel, int coverage_channel, float coverage,
+		unsigned char *out
+	)
+{
+	float scale = 1.0f;
+	int i, c;
+	if( coverage_channel >= 0 )
+	{
+		scale = mipmap_coverage_scale( texels, count, coverage_channel, coverage );
+	}
+	for( i = 0; i < count; ++i )
+	{
+		float v[MIPMAP_TEXEL];
+		memcpy( v, texels + i*MIPMAP_TEXEL, sizeof( v ) );
+		if( (flags & MIPMAP_NORMAL_MAP) && (channels >= 3) )
+		{
+			/*	averaging shortens the normals, bring them back to unit length	*/
+			float length = (float)sqrt( v[0]*v[0] + v[1]*v[1] + v[2]*v[2] );
+			if( length > 1.0e-6f )
+			{
+				v[0] /= length;
+				v[1] /= length;
+				v[2] /= length;
+			} else
+			{
+				v[0] = v[1] = 0.0f;
+				v[2] = 1.0f;
+			}
+		}
+		if( coverage_channel >= 0 )
+		{
+			if( alpha_channel >= 0 )
+			{
+				v[alpha_channel] *= scale;
+			} else
+			{
+				/*	the image is the mask	*/
+				for( c = 0; c < channels; ++c )
+				{
+					v[c] *= scale;
+				}
+			}
+		}
+		for( c = 0; c < channels; ++c )
+		{
+			if( (flags & MIPMAP_NORMAL_MAP) && (channels >= 3) && (c < 3) )
+			{
+				out[c] = mipmap_unorm( v[c] * 0.5f + 0.5f );
+			} else if( (flags & MIPMAP_SRGB) && (c != alpha_channel) )
+			{
+				out[c] = mipmap_linear_to_sRGB( v[c] );
+			} else
+			{
+				out[c] = mipmap_unorm( v[c] );
+			}
+		}
+		out += channels;
+	}
+}
+
+int
+	mipmap_chain_levels
+	(
+		int width, int height
+	)
+{
+	int levels = 1;
+	while( (width > 1) || (height > 1) )
+	{
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+		++levels;
+	}
+	return levels;
+}
+
+int
+	mipmap_chain_size
+	(
+		int width, int height, int channels
+	)
+{
+	int size = width * height * channels;
+	while( (width > 1) || (height > 1) )
+	{
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+		size += width * height * channels;
+	}
+	return size;
+}
+
+int
+	build_mipmap_chain
+	(
+		const unsigned char* const orig,
+		int width, int height, int channels,
+		int filter, int flags,
+		unsigned char* chain
+	)
+{
+	float decode[4][256];
+	float *level, *next, *row;
+	int *x_index, *y_index, *x_count, *y_count;
+	float *x_weight, *y_weight;
+	int taps, level_width, level_height, levels;
+	int alpha_channel = -1, coverage_channel = -1;
+	float coverage = 0.0f;
+	int simd = !(flags & MIPMAP_NO_SIMD);
+	int wrap = (flags & MIPMAP_WRAP) != 0;
+	int i, c;
+	unsigned char *out;
+
+	/*	error check	*/
+	if( (width < 1) || (height < 1) ||
+		(channels < 1) || (channels > 4) ||
+		(orig == NULL) || (chain == NULL) )
+	{
+		/*	nothing to do	*/
+		return 0;
+	}
+	/*	which channel is alpha, and which one the alpha test reads	*/
+	if( (channels == 2) || (channels == 4) )
+	{
+		alpha_channel = channels - 1;
+	}
+	if( flags & MIPMAP_ALPHA_COVERAGE )
+	{
+		coverage_channel = 0;
+		if( alpha_channel >= 0 )
+		{
+			coverage_channel = alpha_channel;
+		} else
+		{
+			/*	no alpha channel: the whole image is a mask,
+				kept linear so the cutoff means the same on every level	*/
+			flags &= ~MIPMAP_SRGB;
+		}
+	}
+	/*	bytes to the values that get filtered	*/
+	for( c = 0; c < channels; ++c )
+	{
+		for( i = 0; i < 256; ++i )
+		{
+			float v = i / 255.0f;
+			if( (flags & MIPMAP_NORMAL_MAP) && (channels >= 3) && (c < 3) )
+			{
+				v = v * 2.0f - 1.0f;
+			} else if( (flags & MIPMAP_SRGB) && (c != alpha_channel) )
+			{
+				v = (v <= 0.04045f) ? v / 12.92f : (float)pow( (v + 0.055f) / 1.055f, 2.4f );
+			}
+			decode[c][i] = v;
+		}
+	}
+
+	/*	level 0 is the image itself	*/
+	memcpy( chain, orig, width*height*channels );
+	levels = mipmap_chain_levels( width, height );
+	if( levels == 1 )
+	{
+		return 1;
+	}
+
+	/*	enough taps for the widest kernel (a 3 texel wide axis going down to 1)	*/
+	taps = 2 * (int)ceil( mipmap_filter_support( filter ) * 3.0f ) + 3;
+	level = (float*)malloc( width*height*MIPMAP_TEXEL*sizeof(float) );
+	next = (float*)malloc( ((width + 1) / 2)*((height + 1) / 2)*MIPMAP_TEXEL*sizeof(float) );
+	row = (float*)malloc( width*MIPMAP_TEXEL*sizeof(float) );
+	x_index = (int*)malloc( width*taps*sizeof(int) );
+	y_index = (int*)malloc( height*taps*sizeof(int) );
+	x_weight = (float*)malloc( width*taps*sizeof(float) );
+	y_weight = (float*)malloc( height*taps*sizeof(float) );
+	x_count = (int*)malloc( width*sizeof(int) );
+	y_count = (int*)malloc( height*sizeof(int) );
+	if( !level || !next || !row || !x_index || !y_index ||
+		!x_weight || !y_weight || !x_count || !y_count )
+	{
+		levels = 0;
+	} else
+	{
+		for( i = 0; i < width*height; ++i )
+		{
+			float *texel = level + i*MIPMAP_TEXEL;
+			texel[0] = texel[1] = texel[2] = texel[3] = 0.0f;
+			for( c = 0; c < channels; ++c )
+			{
+				texel[c] = decode[c][orig[i*channels + c]];
+			}
+		}
+		if( coverage_channel >= 0 )
+		{
+			coverage = mipmap_coverage( level, width*height, coverage_channel, 1.0f );
+		}
+
+		/*	every level is filtered from the float copy of the one before,
+			vertical pass into row, then horizontal pass into next	*/
+		out = chain + width*height*channels;
+		level_width = width;
+		level_height = height;
+		while( (level_width > 1) || (level_height > 1) )
+		{
+			int next_width = (level_width > 1) ? level_width / 2 : 1;
+			int next_height = (level_height > 1) ? level_height / 2 : 1;
+			int y, k;
+			float *swap;
+			mipmap_build_taps( level_width, next_width, filter, wrap, taps, x_index, x_weight, x_count );
+			mipmap_build_taps( level_height, next_height, filter, wrap, taps, y_index, y_weight, y_count );
+			for( y = 0; y < next_height; ++y )
+			{
+				memset( row, 0, level_width*MIPMAP_TEXEL*sizeof(float) );
+				for( k = 0; k < y_count[y]; ++k )
+				{
+					mipmap_row_axpy( row, level + y_index[y*taps + k]*level_width*MIPMAP_TEXEL,
+						y_weight[y*taps + k], level_width*MIPMAP_TEXEL, simd );
+				}
+				mipmap_filter_row( next + y*next_width*MIPMAP_TEXEL, row, next_width,
+					taps, x_index, x_weight, x_count, simd );
+			}
+			mipmap_store_level( next, next_width*next_height, channels, flags,
+				alpha_channel, coverage_channel, coverage, out );
+			out += next_width*next_height*channels;
+			/*	the old level buffer is big enough for any later level	*/
+			swap = level;
+			level = next;
+			next = swap;
+			level_width = next_width;
+			level_height = next_height;
+		}
+	}
+	free( level );
+	free( next );
+	free( row );
+	free( x_index );
+	free( y_index );
+	free( x_weight );
+	free( y_weight );
+	free( x_count );
+	free( y_count );
+	return levels;
+}
+
 int
 	scale_image_RGB_to_NTSC_safe
 	(
@@ -43,6 +43,66 @@ int
 		int block_size_x, int block_size_y
 	);
 
+/*	filters for build_mipmap_chain	*/
+#define MIPMAP_FILTER_BOX		0
+#define MIPMAP_FILTER_KAISER	1
+#define MIPMAP_FILTER_LANCZOS	2
+
+/*	flags for build_mipmap_chain	*/
+/*	color channels hold sRGB data, filter them in linear space	*/
+#define MIPMAP_SRGB				1
+/*	RGB is a normal map, renormalized on every level	*/
+#define MIPMAP_NORMAL_MAP		2
+/*	keep the fraction of texels passing an alpha test at 0.5 equal
+	on every level; images without alpha are a mask themselves	*/
+#define MIPMAP_ALPHA_COVERAGE	4
+/*	the texture repeats, filters wrap around the edges instead of clamping	*/
+#define MIPMAP_WRAP				8
+/*	plain C kernels only, for checking the SIMD ones	*/
+#define MIPMAP_NO_SIMD			16
+
+/**
+	Number of levels in a full MIPmap chain,
+	each level half the size of the one
+	before (rounded down, at least 1).
+**/
+int
+	mipmap_chain_levels
+	(
+		int width, int height
+	);
+
+/**
+	Bytes needed for a full MIPmap chain,
+	level 0 included.
+**/
+int
+	mipmap_chain_size
+	(
+		int width, int height, int channels
+	);
+
+/**
+	This function builds all MIPmaps of
+	an image in one go.  Levels are
+	filtered in floating point from the
+	one before with a separable box,
+	Kaiser or Lanczos kernel (SSE/AVX
+	when available), in any size.
+	chain gets level 0 followed by every
+	smaller level, tightly packed, and
+	must hold mipmap_chain_size bytes.
+	\return the number of levels, 0 if failed
+**/
+int
+	build_mipmap_chain
+	(
+		const unsigned char* const orig,
+		int width, int height, int channels,
+		int filter, int flags,
+		unsigned char* chain
+	);
+
 /**
 	This function takes the RGB components of the image
 	and scales each channel from [0,255] to [16,235].
@@ -0,0 +1,383 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+
+// Headless benchmark mode shared by the executables. With --benchmark the window is hidden, vsync is off and the
+// program renders a fixed number of frames with a fixed timestep (so animations and camera paths are identical on
+// every run), then prints frame time percentiles and a checksum of the last image and exits.
+//
+//   --benchmark[=frames]     frames to measure, 600 by default
+//   --warmup=frames          frames rendered before measuring, 30 by default
+//   --context=native|egl|osmesa
+//                            osmesa also selects GLFW's null platform, so no display server is needed at all
+//                            (software rendering through Mesa's OSMesa / llvmpipe)
+//   --output=path            additionally writes the results as json
+//   --name[=value]           any other option is kept in params for the program itself, e.g. --lights=1024
+//
+// Heap allocations per frame are reported too if exactly one translation unit of the program defines
+// BENCHMARK_COUNT_ALLOCATIONS before including this header: that replaces the global operator new/delete with
+// versions counting every allocation while a benchmark runs.
+struct BenchmarkOptions {
+    bool enabled = false;
+    unsigned int frames = 600;
+    unsigned int warmupFrames = 30;
+    double timestep = 1.0 / 60.0;
+    std::string context = "native";
+    std::string output;
+    std::unordered_map<std::string, std::string> params;
+
+    int intParam(const std::string &name, int fallback) const
+    {
+        auto it = params.find(name);
+        return it != params.end() && !it->second.empty() ? (int)std::strtol(it->second.c_str(), nullptr, 10) : fallback;
+    }
+
+    bool flag(const std::string &name) const { return params.count(name) != 0; }
+};
+
+inline BenchmarkOptions ParseBenchmarkOptions(int argc, char **argv)
+{
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        std::string value;
+        size_t equals = arg.find('=');
+        if (equals != std::string::npos)
+        {
+            value = arg.substr(equals + 1);
+            arg = arg.substr(0, equals);
+        }
+
+        if (arg == "--benchmark")
+        {
+            options.enabled = true;
+            if (!value.empty())
+                options.frames = (unsigned int)(std::max)(1l, std::strtol(value.c_str(), nullptr, 10));
+        }
+        else if (arg == "--warmup")
+            options.warmupFrames = (unsigned int)(std::max)(0l, std::strtol(value.c_str(), nullptr, 10));
+        else if (arg == "--context")
+            options.context = value;
+        else if (arg == "--output")
+            options.output = value;
+        else if (arg.compare(0, 2, "--") == 0 && arg.size() > 2)
+            options.params[arg.substr(2)] = value;
+        else
+            std::cout << "WARNING::BENCHMARK::unknown argument " << argv[i] << std::endl;
+    }
+    return options;
+}
+
+// call before glfwInit()
+inline void ApplyBenchmarkInitHints(const BenchmarkOptions &options)
+{
+    if (options.enabled && options.context == "osmesa")
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+}
+
+// call after glfwInit(), before glfwCreateWindow()
+inline void ApplyBenchmarkWindowHints(const BenchmarkOptions &options)
+{
+    if (!options.enabled)
+        return;
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    if (options.context == "egl")
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    else if (options.context == "osmesa")
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+}
+
+// number of heap allocations made through operator new since counting was enabled
+inline std::atomic<uint64_t> &AllocationCounter()
+{
+    static std::atomic<uint64_t> counter(0);
+    return counter;
+}
+
+inline std::atomic<bool> &AllocationCountingEnabled()
+{
+    static std::atomic<bool> enabled(false);
+    return enabled;
+}
+
+inline uint64_t AllocationCount()
+{
+    return AllocationCounter().load(std::memory_order_relaxed);
+}
+
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+void *operator new(std::size_t size)
+{
+    if (AllocationCountingEnabled().load(std::memory_order_relaxed))
+        AllocationCounter().fetch_add(1, std::memory_order_relaxed);
+    void *p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+void *operator new[](std::size_t size) { return ::operator new(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    try { return ::operator new(size); }
+    catch (...) { return nullptr; }
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return ::operator new(size, std::nothrow); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
+#endif
+
+// 64 bit FNV-1a over the RGBA8 pixels of the currently bound read framebuffer (see BenchmarkCapture)
+inline uint64_t FramebufferChecksum(int width, int height)
+{
+    std::vector<unsigned char> pixels((size_t)width * height * 4);
+    GLint alignment;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, alignment);
+
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char byte : pixels)
+    {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Collects the wall clock time and the heap allocations between consecutive frameEnd() calls and drives the
+// fixed timestep.
+class BenchmarkRun
+{
+public:
+    explicit BenchmarkRun(const BenchmarkOptions &options) : options(options)
+    {
+        times.reserve(options.frames);
+        allocations.reserve(options.frames);
+        last = std::chrono::steady_clock::now();
+        if (options.enabled)
+            AllocationCountingEnabled() = true;
+        lastAllocations = AllocationCount();
+    }
+
+    ~BenchmarkRun()
+    {
+        if (options.enabled)
+            AllocationCountingEnabled() = false;
+    }
+
+    // simulated time of the current frame, use instead of glfwGetTime() for animations
+    double time() const { return frame * options.timestep; }
+    unsigned int frameIndex() const { return frame; }
+
+    // true for the last frame, read the checksum before swapping it
+    bool lastFrame() const { return frame + 1 == options.warmupFrames + options.frames; }
+    bool finished() const { return frame >= options.warmupFrames + options.frames; }
+
+    void frameEnd()
+    {
+        auto now = std::chrono::steady_clock::now();
+        uint64_t allocated = AllocationCount();
+        if (frame >= options.warmupFrames)
+        {
+            times.push_back(std::chrono::duration<double, std::milli>(now - last).count());
+            allocations.push_back(allocated - lastAllocations);
+        }
+        last = now;
+        lastAllocations = allocated;
+        frame++;
+    }
+
+    // adds the allocations a part of the frame made, e.g. AllocationCount() after minus before Model::Draw.
+    // Reported per measured frame next to the whole frame's count.
+    void countAllocations(const std::string &scope, uint64_t count)
+    {
+        if (frame < options.warmupFrames)
+            return;
+        auto it = std::find_if(scopeAllocations.begin(), scopeAllocations.end(), [&](const ScopeAllocations &s) { return s.name == scope; });
+        if (it == scopeAllocations.end())
+            it = scopeAllocations.insert(scopeAllocations.end(), ScopeAllocations{ scope, 0, 0 });
+        it->total += count;
+        it->max = (std::max)(it->max, count);
+    }
+
+    void setChecksum(uint64_t value) { checksum = value; }
+
+    // percentile in [0, 100] of the measured frame times, nearest rank
+    double percentile(double p) const
+    {
+        if (times.empty())
+            return 0.0;
+        std::vector<double> sorted = times;
+        std::sort(sorted.begin(), sorted.end());
+        size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+        return sorted[(std::min)(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+    }
+
+    double mean() const
+    {
+        double sum = 0.0;
+        for (double t : times)
+            sum += t;
+        return times.empty() ? 0.0 : sum / times.size();
+    }
+
+    void report(const std::string &name, const char *renderer) const
+    {
+        std::ostringstream hex;
+        hex << std::hex << std::setw(16) << std::setfill('0') << checksum;
+
+        std::cout << std::fixed << std::setprecision(3)
+                  << "benchmark " << name << " on " << (renderer ? renderer : "unknown renderer") << "\n"
+                  << "frames: " << times.size() << " (+" << options.warmupFrames << " warmup)"
+                  << "  mean: " << mean() << " ms  p50: " << percentile(50) << " ms  p90: " << percentile(90)
+                  << " ms  p99: " << percentile(99) << " ms  max: " << percentile(100) << " ms\n"
+                  << "checksum: " << hex.str() << std::endl << std::defaultfloat;
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+        std::cout << "allocations/frame: " << meanAllocations() << " (max " << maxAllocations() << ")";
+        for (const ScopeAllocations &scope : scopeAllocations)
+            std::cout << "  " << scope.name << ": " << (times.empty() ? 0.0 : (double)scope.total / times.size())
+                      << " (max " << scope.max << ")";
+        std::cout << std::endl;
+#endif
+
+        if (options.output.empty())
+            return;
+        std::ofstream out(options.output, std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ERROR::BENCHMARK::can't write " << options.output << std::endl;
+            return;
+        }
+        out << std::fixed << std::setprecision(4)
+            << "{\n  \"name\": \"" << name << "\",\n  \"renderer\": \"" << (renderer ? renderer : "") << "\",\n"
+            << "  \"frames\": " << times.size() << ",\n  \"warmup\": " << options.warmupFrames << ",\n"
+            << "  \"timestep\": " << options.timestep << ",\n"
+            << "  \"mean_ms\": " << mean() << ",\n  \"p50_ms\": " << percentile(50) << ",\n"
+            << "  \"p90_ms\": " << percentile(90) << ",\n  \"p99_ms\": " << percentile(99) << ",\n"
+            << "  \"max_ms\": " << percentile(100) << ",\n";
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+        out << "  \"allocations_per_frame\": " << meanAllocations() << ",\n  \"max_allocations\": " << maxAllocations() << ",\n";
+        for (const ScopeAllocations &scope : scopeAllocations)
+            out << "  \"" << scope.name << " allocations_per_frame\": " << (times.empty() ? 0.0 : (double)scope.total / times.size()) << ",\n";
+#endif
+        out << "  \"checksum\": \"" << hex.str() << "\"\n}\n";
+    }
+
+    double meanAllocations() const
+    {
+        uint64_t sum = 0;
+        for (uint64_t a : allocations)
+            sum += a;
+        return allocations.empty() ? 0.0 : (double)sum / allocations.size();
+    }
+
+    uint64_t maxAllocations() const
+    {
+        return allocations.empty() ? 0 : *std::max_element(allocations.begin(), allocations.end());
+    }
+
+private:
+    struct ScopeAllocations {
+        std::string name;
+        uint64_t total, max;
+    };
+
+    BenchmarkOptions options;
+    std::vector<double> times;
+    std::vector<uint64_t> allocations;
+    std::vector<ScopeAllocations> scopeAllocations;
+    std::chrono::steady_clock::time_point last;
+    unsigned int frame = 0;
+    uint64_t lastAllocations = 0;
+    uint64_t checksum = 0;
+};
+
+// Offscreen target for the image that gets checksummed. The benchmark window is hidden, and the contents of a hidden
+// window's default framebuffer are undefined (pixels it doesn't own may never be written), so the final image of the
+// last frame is rendered here instead, read back from here and then blitted to the window.
+class BenchmarkCapture
+{
+public:
+    // framebuffer the final image has to be rendered into: the capture target if capture is set, otherwise the
+    // default framebuffer
+    GLuint target(bool capture, int width, int height)
+    {
+        if (!capture)
+            return 0;
+        if (!fbo || width != this->width || height != this->height)
+            create(width, height);
+        return fbo;
+    }
+
+    // checksum of the image rendered into target(); also blits it to the default framebuffer and leaves that bound
+    uint64_t checksum()
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        uint64_t value = FramebufferChecksum(width, height);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return value;
+    }
+
+    void release()
+    {
+        if (fbo)
+        {
+            glDeleteFramebuffers(1, &fbo);
+            glDeleteRenderbuffers(2, renderbuffers);
+        }
+        fbo = 0;
+        width = height = 0;
+    }
+
+private:
+    void create(int width, int height)
+    {
+        release();
+        this->width = width;
+        this->height = height;
+        glGenFramebuffers(1, &fbo);
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::BENCHMARK::capture framebuffer is not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    GLuint fbo = 0;
+    GLuint renderbuffers[2] = { 0, 0 };
+    int width = 0, height = 0;
+};
+#endif
@@ -0,0 +1,418 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/frustum.h>
+
+#include <cfloat>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+struct Aabb {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    void grow(const glm::vec3 &p) { min = glm::min(min, p); max = glm::max(max, p); }
+    void grow(const Aabb &box) { min = glm::min(min, box.min); max = glm::max(max, box.max); }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+    float area() const
+    {
+        glm::vec3 d = max - min;
+        return d.x < 0.0f ? 0.0f : 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+};
+
+// box of a unit cube (or any box given by its half size) after an affine transform
+inline Aabb TransformBox(const glm::mat4 &transform, const glm::vec3 &center, const glm::vec3 &halfSize)
+{
+    glm::vec3 c = glm::vec3(transform * glm::vec4(center, 1.0f));
+    glm::mat3 m(transform);
+    glm::vec3 e = glm::abs(m[0]) * halfSize.x + glm::abs(m[1]) * halfSize.y + glm::abs(m[2]) * halfSize.z;
+    Aabb box;
+    box.min = c - e;
+    box.max = c + e;
+    return box;
+}
+
+// slab test, the entry distance is written to tNear. invDirection is 1 / ray.direction per component.
+inline bool IntersectRayBox(const Ray &ray, const glm::vec3 &invDirection, const glm::vec3 &min, const glm::vec3 &max, float maxT, float &tNear)
+{
+    glm::vec3 t0 = (min - ray.origin) * invDirection;
+    glm::vec3 t1 = (max - ray.origin) * invDirection;
+    glm::vec3 tmin = glm::min(t0, t1), tmax = glm::max(t0, t1);
+    tNear = (std::max)((std::max)(tmin.x, tmin.y), (std::max)(tmin.z, 0.0f));
+    float tFar = (std::min)((std::min)(tmax.x, tmax.y), (std::min)(tmax.z, maxT));
+    return tNear <= tFar;
+}
+
+// Moller-Trumbore, both faces
+inline bool IntersectRayTriangle(const Ray &ray, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, float &t)
+{
+    glm::vec3 e1 = b - a, e2 = c - a;
+    glm::vec3 p = glm::cross(ray.direction, e2);
+    float det = glm::dot(e1, p);
+    if (std::fabs(det) < 1e-8f)
+        return false;
+    float invDet = 1.0f / det;
+    glm::vec3 s = ray.origin - a;
+    float u = glm::dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+    glm::vec3 q = glm::cross(s, e1);
+    float v = glm::dot(ray.direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+    t = glm::dot(e2, q) * invDet;
+    return t >= 0.0f;
+}
+
+// boxes of the triangles of an indexed mesh, positions are vec3 stride bytes apart
+inline std::vector<Aabb> TriangleBounds(const void *positions, size_t stride, const unsigned int *indices, size_t indexCount)
+{
+    const unsigned char *bytes = (const unsigned char *)positions;
+    std::vector<Aabb> boxes(indexCount / 3);
+    for (size_t i = 0; i < boxes.size(); i++)
+        for (int k = 0; k < 3; k++)
+            boxes[i].grow(*(const glm::vec3 *)(bytes + indices[i * 3 + k] * stride));
+    return boxes;
+}
+
+struct BvhNode {
+    glm::vec3 min;
+    uint32_t leftOrFirst;   // inner node: index of the left child, the right one follows it. leaf: first primitive slot
+    glm::vec3 max;
+    uint32_t count;         // primitives of a leaf, 0 for inner nodes
+};
+static_assert(sizeof(BvhNode) == 32, "two BvhNodes per cache line");
+
+// Bounding volume hierarchy over a set of boxes; works for triangles of a mesh (TriangleBounds) and for whole
+// objects alike, the primitive ids it reports are the indices into the box array it was built from.
+//
+// The build bins centroids into SAH_BINS buckets per axis and picks the split with the lowest surface area cost,
+// subtrees above PARALLEL_THRESHOLD primitives are built on their own thread. The result is flattened into one
+// array in depth first order, siblings adjacent and children after their parent, so refit() is a single backwards
+// sweep. Refitting keeps the topology: fine for objects that move a little (the rotating cubes), rebuild when the
+// scene changes a lot.
+class Bvh
+{
+public:
+    static const int SAH_BINS = 12;
+    static const size_t PARALLEL_THRESHOLD = 16384;
+
+    std::vector<BvhNode> nodes;
+    std::vector<uint32_t> primitives;   // leaf slots -> primitive ids
+
+    void build(const std::vector<Aabb> &boxes, unsigned int maxLeafSize = 4)
+    {
+        nodes.clear();
+        primitives.resize(boxes.size());
+        for (size_t i = 0; i < boxes.size(); i++)
+            primitives[i] = (uint32_t)i;
+        if (boxes.empty())
+            return;
+
+        std::vector<glm::vec3> centers(boxes.size());
+        for (size_t i = 0; i < boxes.size(); i++)
+            centers[i] = boxes[i].center();
+
+        BuildContext context = { boxes, centers, (std::max)(1u, maxLeafSize) };
+        unsigned int threads = (std::max)(1u, std::thread::hardware_concurrency());
+        int parallelDepth = 0;
+        while ((1u << parallelDepth) < threads)
+            parallelDepth++;
+        std::unique_ptr<BuildNode> root = buildNode(context, 0, (uint32_t)boxes.size(), parallelDepth);
+
+        nodes.reserve(root->nodeCount);
+        nodes.push_back(BvhNode());
+        flatten(*root, 0);
+    }
+
+    // recomputes the node boxes bottom up for moved primitives, boxes must have the same order and size as in build()
+    void refit(const std::vector<Aabb> &boxes)
+    {
+        for (size_t n = nodes.size(); n-- > 0;)
+        {
+            BvhNode &node = nodes[n];
+            Aabb box;
+            if (node.count > 0)
+            {
+                for (uint32_t i = 0; i < node.count; i++)
+                    box.grow(boxes[primitives[node.leftOrFirst + i]]);
+            }
+            else
+            {
+                const BvhNode &left = nodes[node.leftOrFirst], &right = nodes[node.leftOrFirst + 1];
+                box.min = glm::min(left.min, right.min);
+                box.max = glm::max(left.max, right.max);
+            }
+            node.min = box.min;
+            node.max = box.max;
+        }
+    }
+
+    // closest hit along the ray. test(primitive, ray, maxT, t) does the exact intersection and returns true with
+    // the distance in t. Returns the primitive id or UINT32_MAX, the distance in hitT.
+    template <typename Test>
+    uint32_t raycast(const Ray &ray, Test test, float &hitT, float maxT = FLT_MAX) const
+    {
+        uint32_t hit = UINT32_MAX;
+        hitT = maxT;
+        if (nodes.empty())
+            return hit;
+
+        glm::vec3 invDirection = 1.0f / ray.direction;
+        uint32_t stack[64];
+        int top = 0;
+        float tNear;
+        if (!IntersectRayBox(ray, invDirection, nodes[0].min, nodes[0].max, hitT, tNear))
+            return hit;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const BvhNode &node = nodes[stack[--top]];
+            if (node.count > 0)
+            {
+                for (uint32_t i = 0; i < node.count; i++)
+                {
+                    float t;
+                    uint32_t primitive = primitives[node.leftOrFirst + i];
+                    if (test(primitive, ray, hitT, t) && t < hitT)
+                    {
+                        hitT = t;
+                        hit = primitive;
+                    }
+                }
+                continue;
+            }
+
+            // visit the nearer child first, it's likely to shorten the ray for the other one
+            uint32_t first = node.leftOrFirst, second = node.leftOrFirst + 1;
+            float tFirst, tSecond;
+            bool hitFirst = IntersectRayBox(ray, invDirection, nodes[first].min, nodes[first].max, hitT, tFirst);
+            bool hitSecond = IntersectRayBox(ray, invDirection, nodes[second].min, nodes[second].max, hitT, tSecond);
+            if (hitFirst && hitSecond && tSecond < tFirst)
+                std::swap(first, second);
+            if (hitFirst && hitSecond)
+            {
+                stack[top++] = second;
+                stack[top++] = first;
+            }
+            else if (hitFirst || hitSecond)
+                stack[top++] = hitFirst ? node.leftOrFirst : node.leftOrFirst + 1;
+        }
+        return hit;
+    }
+
+    // appends the ids of the primitives whose leaf boxes touch the frustum; subtrees fully inside are taken whole
+    void query(const Frustum &frustum, std::vector<uint32_t> &result) const
+    {
+        if (nodes.empty())
+            return;
+        uint32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const BvhNode &node = nodes[stack[--top]];
+            glm::vec3 center = (node.min + node.max) * 0.5f, extents = (node.max - node.min) * 0.5f;
+            int state = classify(frustum, center, extents);
+            if (state < 0)
+                continue;
+            if (state > 0)
+            {
+                appendSubtree(node, result);
+                continue;
+            }
+            if (node.count > 0)
+            {
+                for (uint32_t i = 0; i < node.count; i++)
+                    result.push_back(primitives[node.leftOrFirst + i]);
+                continue;
+            }
+            stack[top++] = node.leftOrFirst + 1;
+            stack[top++] = node.leftOrFirst;
+        }
+    }
+
+private:
+    struct BuildContext {
+        const std::vector<Aabb> &boxes;
+        const std::vector<glm::vec3> &centers;
+        unsigned int maxLeafSize;
+    };
+
+    struct BuildNode {
+        Aabb box;
+        uint32_t first = 0, count = 0;
+        size_t nodeCount = 1;   // nodes in this subtree
+        std::unique_ptr<BuildNode> left, right;
+    };
+
+    // primitives[first, first + count) become one subtree
+    std::unique_ptr<BuildNode> buildNode(const BuildContext &context, uint32_t first, uint32_t count, int parallelDepth)
+    {
+        std::unique_ptr<BuildNode> node(new BuildNode());
+        Aabb centroidBox;
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            node->box.grow(context.boxes[primitives[i]]);
+            centroidBox.grow(context.centers[primitives[i]]);
+        }
+
+        int axis;
+        uint32_t split = count <= context.maxLeafSize ? 0 : findSplit(context, first, count, node->box, centroidBox, axis);
+        if (split == 0)
+        {
+            node->first = first;
+            node->count = count;
+            return node;
+        }
+
+        // partition by the chosen bin boundary
+        float lo = centroidBox.min[axis], scale = SAH_BINS / (centroidBox.max[axis] - lo);
+        uint32_t *begin = primitives.data() + first;
+        uint32_t *middle = std::partition(begin, begin + count, [&](uint32_t p)
+        {
+            return binOf(context.centers[p][axis], lo, scale) < (int)split;
+        });
+        uint32_t leftCount = (uint32_t)(middle - begin);
+        if (leftCount == 0 || leftCount == count)
+        {
+            node->first = first;
+            node->count = count;
+            return node;
+        }
+
+        if (parallelDepth > 0 && count >= PARALLEL_THRESHOLD)
+        {
+            // the ranges are disjoint, so both halves can partition primitives concurrently
+            auto left = std::async(std::launch::async, [&]() { return buildNode(context, first, leftCount, parallelDepth - 1); });
+            node->right = buildNode(context, first + leftCount, count - leftCount, parallelDepth - 1);
+            node->left = left.get();
+        }
+        else
+        {
+            node->left = buildNode(context, first, leftCount, 0);
+            node->right = buildNode(context, first + leftCount, count - leftCount, 0);
+        }
+        node->nodeCount = 1 + node->left->nodeCount + node->right->nodeCount;
+        return node;
+    }
+
+    static int binOf(float value, float lo, float scale)
+    {
+        return (std::min)(SAH_BINS - 1, (std::max)(0, (int)((value - lo) * scale)));
+    }
+
+    // best SAH split over all axes, returns the first bin of the right side or 0 if a leaf is cheaper
+    uint32_t findSplit(const BuildContext &context, uint32_t first, uint32_t count, const Aabb &box, const Aabb &centroidBox, int &bestAxis) const
+    {
+        float bestCost = (float)count * box.area();   // cost of not splitting, relative to the traversal step
+        uint32_t bestSplit = 0;
+        bestAxis = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float extent = centroidBox.max[axis] - centroidBox.min[axis];
+            if (extent <= 0.0f)
+                continue;
+            float lo = centroidBox.min[axis], scale = SAH_BINS / extent;
+
+            Aabb bins[SAH_BINS];
+            uint32_t binCounts[SAH_BINS] = {};
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                uint32_t p = primitives[i];
+                int bin = binOf(context.centers[p][axis], lo, scale);
+                bins[bin].grow(context.boxes[p]);
+                binCounts[bin]++;
+            }
+
+            // sweep from the right to get the area/count of every right side, then from the left
+            float rightArea[SAH_BINS];
+            uint32_t rightCount[SAH_BINS];
+            Aabb right;
+            uint32_t rightSum = 0;
+            for (int b = SAH_BINS - 1; b > 0; b--)
+            {
+                right.grow(bins[b]);
+                rightSum += binCounts[b];
+                rightArea[b] = right.area();
+                rightCount[b] = rightSum;
+            }
+            Aabb left;
+            uint32_t leftSum = 0;
+            for (int b = 1; b < SAH_BINS; b++)
+            {
+                left.grow(bins[b - 1]);
+                leftSum += binCounts[b - 1];
+                if (leftSum == 0 || rightCount[b] == 0)
+                    continue;
+                float cost = 0.125f * box.area() + leftSum * left.area() + rightCount[b] * rightArea[b];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestSplit = (uint32_t)b;
+                    bestAxis = axis;
+                }
+            }
+        }
+        return bestSplit;
+    }
+
+    // writes node into nodes[index]; its children get two adjacent slots at the end
+    void flatten(const BuildNode &node, size_t index)
+    {
+        BvhNode &flat = nodes[index];
+        flat.min = node.box.min;
+        flat.max = node.box.max;
+        flat.count = node.count;
+        if (node.count > 0)
+        {
+            flat.leftOrFirst = node.first;
+            return;
+        }
+        uint32_t left = (uint32_t)nodes.size();
+        flat.leftOrFirst = left;
+        nodes.push_back(BvhNode());
+        nodes.push_back(BvhNode());
+        flatten(*node.left, left);
+        flatten(*node.right, left + 1);
+    }
+
+    // -1 outside, 1 fully inside, 0 crossing
+    static int classify(const Frustum &frustum, const glm::vec3 &center, const glm::vec3 &extents)
+    {
+        int state = 1;
+        for (const glm::vec4 &plane : frustum.planes)
+        {
+            glm::vec3 n(plane);
+            float d = glm::dot(n, center) + plane.w;
+            float r = glm::dot(glm::abs(n), extents);
+            if (d + r < 0.0f)
+                return -1;
+            if (d - r < 0.0f)
+                state = 0;
+        }
+        return state;
+    }
+
+    void appendSubtree(const BvhNode &node, std::vector<uint32_t> &result) const
+    {
+        if (node.count > 0)
+        {
+            for (uint32_t i = 0; i < node.count; i++)
+                result.push_back(primitives[node.leftOrFirst + i]);
+            return;
+        }
+        appendSubtree(nodes[node.leftOrFirst], result);
+        appendSubtree(nodes[node.leftOrFirst + 1], result);
+    }
+};
+#endif
@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/frustum.h>
+
 #include <vector>
 
 // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
@@ -66,6 +68,13 @@ public:
         return glm::lookAt(Position, Position + Front, Up);
     }
 
+    // Returns the world space ray through the window point (x, y) for picking, using the camera's Zoom as vertical fov
+    Ray GetRay(float x, float y, float width, float height)
+    {
+        glm::mat4 projection = glm::perspective(glm::radians(Zoom), width / height, 0.1f, 100.0f);
+        return ScreenRay(x, y, width, height, GetViewMatrix(), projection);
+    }
+
     // Processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void ProcessKeyboard(Camera_Movement direction, float deltaTime)
     {
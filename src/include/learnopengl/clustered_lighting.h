@@ -0,0 +1,261 @@
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+// point light with a finite range; shaders fade it to zero at radius
+struct PointLight {
+    glm::vec3 position;
+    float radius;
+    glm::vec3 color;
+    float padding = 0.0f;
+};
+static_assert(sizeof(PointLight) == 8 * sizeof(float), "PointLight must match two RGBA32F texels");
+
+// range at which an inverse square light of this color drops below threshold
+inline float PointLightRadius(const glm::vec3 &color, float threshold = 0.01f)
+{
+    float intensity = (std::max)(color.r, (std::max)(color.g, color.b));
+    return std::sqrt(intensity / threshold);
+}
+
+// Clustered forward shading. The view frustum is split into tilesX * tilesY screen tiles and slices depth slices
+// (exponentially spaced, so clusters stay roughly cubic), and every frame each cluster gets the list of lights whose
+// sphere touches it. The lists are built on the CPU and uploaded into three texture buffers, core since GL 3.1:
+//
+//   lights       RGBA32F, 2 texels per light: position.xyz + radius, color.rgb
+//   clusters     RG32UI, per cluster: offset into indices, light count
+//   indices      R32UI, the concatenated per-cluster light lists
+//
+// cluster index = tile.x + tile.y * tilesX + slice * tilesX * tilesY, slice = int(log(viewDepth) * scale + bias),
+// see bind() for the uniforms the fragment shader needs. The GL objects are created by the first build(), call
+// release() before the context is destroyed.
+class LightClusters
+{
+public:
+    int tilesX, tilesY, slices;
+
+    LightClusters(int tilesX = 16, int tilesY = 9, int slices = 24) : tilesX(tilesX), tilesY(tilesY), slices(slices)
+    {
+    }
+
+    LightClusters(const LightClusters &) = delete;
+    LightClusters &operator=(const LightClusters &) = delete;
+
+    // assigns lights (world space) to the clusters of a symmetric perspective frustum and uploads the result
+    void build(const std::vector<PointLight> &lights, const glm::mat4 &view, float fovY, float aspect, float zNear, float zFar)
+    {
+        if (!buffers[0])
+        {
+            glGenBuffers(3, buffers);
+            glGenTextures(3, textures);
+        }
+        nearPlane = zNear;
+        farPlane = zFar;
+        float logRatio = std::log(zFar / zNear);
+        sliceScale = slices / logRatio;
+        sliceBias = -slices * std::log(zNear) / logRatio;
+
+        float tanY = std::tan(fovY * 0.5f);
+        float tanX = tanY * aspect;
+        int clusterCount = tilesX * tilesY * slices;
+
+        // per light cluster ranges first (count pass), then a prefix sum, then the fill pass
+        counts.assign(clusterCount, 0u);
+        ranges.clear();
+        for (unsigned int i = 0; i < lights.size(); i++)
+        {
+            const PointLight &light = lights[i];
+            glm::vec3 p = glm::vec3(view * glm::vec4(light.position, 1.0f));
+            float depth = -p.z;
+            float r = light.radius;
+            if (depth + r < zNear || depth - r > zFar)
+                continue;
+
+            LightRange range;
+            range.light = i;
+            range.z0 = slice((std::max)(depth - r, zNear));
+            range.z1 = slice((std::min)(depth + r, zFar));
+
+            // screen bounds from the light's view space bounding box, the whole screen if it reaches the camera plane
+            float minDepth = (std::max)(depth - r, zNear);
+            if (depth - r <= zNear)
+            {
+                range.x0 = 0; range.x1 = tilesX - 1;
+                range.y0 = 0; range.y1 = tilesY - 1;
+            }
+            else
+            {
+                float x0 = (std::min)((p.x - r) / (minDepth * tanX), (p.x - r) / ((depth + r) * tanX));
+                float x1 = (std::max)((p.x + r) / (minDepth * tanX), (p.x + r) / ((depth + r) * tanX));
+                float y0 = (std::min)((p.y - r) / (minDepth * tanY), (p.y - r) / ((depth + r) * tanY));
+                float y1 = (std::max)((p.y + r) / (minDepth * tanY), (p.y + r) / ((depth + r) * tanY));
+                if (x1 < -1.0f || x0 > 1.0f || y1 < -1.0f || y0 > 1.0f)
+                    continue;
+                range.x0 = tile(x0, tilesX); range.x1 = tile(x1, tilesX);
+                range.y0 = tile(y0, tilesY); range.y1 = tile(y1, tilesY);
+            }
+
+            // keep only the clusters whose view space box actually touches the sphere
+            range.first = (unsigned int)hits.size();
+            for (int z = range.z0; z <= range.z1; z++)
+            {
+                float zn = zNear * std::pow(zFar / zNear, (float)z / slices);
+                float zf = zNear * std::pow(zFar / zNear, (float)(z + 1) / slices);
+                for (int y = range.y0; y <= range.y1; y++)
+                {
+                    for (int x = range.x0; x <= range.x1; x++)
+                    {
+                        if (!touches(p, r, x, y, zn, zf, tanX, tanY))
+                            continue;
+                        unsigned int cluster = x + y * tilesX + z * tilesX * tilesY;
+                        hits.push_back(cluster);
+                        counts[cluster]++;
+                    }
+                }
+            }
+            range.count = (unsigned int)hits.size() - range.first;
+            ranges.push_back(range);
+        }
+
+        clusterData.resize(clusterCount * 2);
+        unsigned int offset = 0;
+        for (int c = 0; c < clusterCount; c++)
+        {
+            clusterData[c * 2] = offset;
+            clusterData[c * 2 + 1] = 0;
+            offset += counts[c];
+        }
+        indices.resize((std::max)(offset, 1u));
+        for (const LightRange &range : ranges)
+        {
+            for (unsigned int h = range.first; h < range.first + range.count; h++)
+            {
+                unsigned int cluster = hits[h];
+                indices[clusterData[cluster * 2] + clusterData[cluster * 2 + 1]++] = range.light;
+            }
+        }
+        hits.clear();
+        assignments = offset;
+
+        upload(0, GL_RGBA32F, lights.empty() ? nullptr : lights.data(), (std::max)(lights.size(), (size_t)1) * sizeof(PointLight));
+        upload(1, GL_RG32UI, clusterData.data(), clusterData.size() * sizeof(unsigned int));
+        upload(2, GL_R32UI, indices.data(), indices.size() * sizeof(unsigned int));
+    }
+
+    // binds the three buffers to firstUnit .. firstUnit + 2 and sets the cluster uniforms of the current program:
+    // lightData, clusterData, lightIndices (samplers), clusterTiles (ivec3), clusterTileSize (vec2, pixels),
+    // clusterScale, clusterBias, clusterNear, clusterFar
+    void bind(GLuint program, int firstUnit, int viewportWidth, int viewportHeight)
+    {
+        // locations are looked up once per program
+        if (program != boundProgram)
+        {
+            const char *names[UNIFORM_COUNT] = { "lightData", "clusterData", "lightIndices", "clusterTiles",
+                "clusterTileSize", "clusterScale", "clusterBias", "clusterNear", "clusterFar" };
+            for (int i = 0; i < UNIFORM_COUNT; i++)
+                locations[i] = glGetUniformLocation(program, names[i]);
+            boundProgram = program;
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+            glUniform1i(locations[i], firstUnit + i);
+        }
+        glActiveTexture(GL_TEXTURE0);
+        glUniform3i(locations[3], tilesX, tilesY, slices);
+        glUniform2f(locations[4], (float)viewportWidth / tilesX, (float)viewportHeight / tilesY);
+        glUniform1f(locations[5], sliceScale);
+        glUniform1f(locations[6], sliceBias);
+        glUniform1f(locations[7], nearPlane);
+        glUniform1f(locations[8], farPlane);
+    }
+
+    // total light/cluster pairs of the last build, the average per cluster is what the shader loops over
+    size_t lightAssignments() const { return assignments; }
+    size_t clusterCount() const { return (size_t)tilesX * tilesY * slices; }
+
+    void release()
+    {
+        if (!buffers[0])
+            return;
+        glDeleteBuffers(3, buffers);
+        glDeleteTextures(3, textures);
+        buffers[0] = 0;
+        boundProgram = 0;
+    }
+
+private:
+    struct LightRange {
+        unsigned int light;
+        int x0, x1, y0, y1, z0, z1;
+        unsigned int first, count;
+    };
+
+    static const int UNIFORM_COUNT = 9;
+
+    GLuint buffers[3] = { 0, 0, 0 };
+    GLuint textures[3] = { 0, 0, 0 };
+    GLuint boundProgram = 0;
+    GLint locations[UNIFORM_COUNT];
+    float nearPlane = 0.1f, farPlane = 100.0f;
+    float sliceScale = 0.0f, sliceBias = 0.0f;
+    size_t assignments = 0;
+
+    // scratch, kept to avoid reallocating every frame
+    std::vector<unsigned int> counts;
+    std::vector<unsigned int> clusterData;
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> hits;
+    std::vector<LightRange> ranges;
+
+    int slice(float depth) const
+    {
+        int s = (int)std::floor(std::log(depth) * sliceScale + sliceBias);
+        return (std::min)((std::max)(s, 0), slices - 1);
+    }
+
+    static int tile(float ndc, int tiles)
+    {
+        int t = (int)std::floor((ndc * 0.5f + 0.5f) * tiles);
+        return (std::min)((std::max)(t, 0), tiles - 1);
+    }
+
+    // sphere against the view space bounding box of cluster (x, y) between depths zn and zf
+    bool touches(const glm::vec3 &p, float r, int x, int y, float zn, float zf, float tanX, float tanY) const
+    {
+        float ndcX0 = (float)x / tilesX * 2.0f - 1.0f, ndcX1 = (float)(x + 1) / tilesX * 2.0f - 1.0f;
+        float ndcY0 = (float)y / tilesY * 2.0f - 1.0f, ndcY1 = (float)(y + 1) / tilesY * 2.0f - 1.0f;
+        glm::vec3 lo(
+            (std::min)(ndcX0 * zn, ndcX0 * zf) * tanX,
+            (std::min)(ndcY0 * zn, ndcY0 * zf) * tanY,
+            -zf);
+        glm::vec3 hi(
+            (std::max)(ndcX1 * zn, ndcX1 * zf) * tanX,
+            (std::max)(ndcY1 * zn, ndcY1 * zf) * tanY,
+            -zn);
+        glm::vec3 closest = glm::clamp(p, lo, hi);
+        glm::vec3 d = closest - p;
+        return glm::dot(d, d) <= r * r;
+    }
+
+    void upload(int i, GLenum format, const void *data, size_t bytes)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, bytes, NULL, GL_STREAM_DRAW); // orphan last frame's storage
+        if (data)
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffers[i]);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+};
+#endif
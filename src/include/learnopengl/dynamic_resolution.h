@@ -0,0 +1,101 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <cmath>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+// Picks the render scale that keeps the measured GPU time of the scaled passes under a budget.
+// GPU time is assumed to grow with the pixel count, i.e. with scale^2, so the scale that would just meet the
+// budget is scale * sqrt(budget / time). To avoid oscillating (and re-allocating render targets every frame) the
+// controller works on a smoothed time, snaps the scale to fixed steps, only lowers it when the time is clearly
+// over budget, only raises it when there is clear headroom, and waits a few frames after every change so the
+// delayed timer queries catch up.
+class DynamicResolution
+{
+public:
+    float budgetMs;
+    float minScale;
+    float maxScale;
+    float step = 0.05f;             // scales are multiples of this
+    float overBudget = 1.05f;       // lower the scale above budget * overBudget
+    float underBudget = 0.85f;      // raise the scale below budget * underBudget
+    float smoothing = 0.1f;         // weight of the newest sample in the running average
+    unsigned int cooldownFrames = 30;
+
+    DynamicResolution(float budgetMs, float minScale = 0.5f, float maxScale = 1.0f)
+        : budgetMs(budgetMs), minScale(minScale), maxScale(maxScale), current((std::max)(maxScale, 0.01f))
+    {
+    }
+
+    // writes one csv line per update() to the given file, empty path stops logging
+    bool openLog(const std::string &path)
+    {
+        log.close();
+        if (path.empty())
+            return true;
+        log.open(path, std::ios::trunc);
+        if (!log)
+        {
+            std::cout << "ERROR::DYNAMIC_RESOLUTION::can't write " << path << std::endl;
+            return false;
+        }
+        log << "frame,gpu_ms,smoothed_ms,scale,changed\n";
+        return true;
+    }
+
+    // feeds the GPU time of the last measured frame (at the scale that was current then) and returns the scale
+    // to render the next frame at
+    float update(float gpuMs)
+    {
+        frame++;
+        smoothed = samples == 0 ? gpuMs : smoothed + (gpuMs - smoothed) * smoothing;
+        samples++;
+
+        bool changed = false;
+        if (cooldown > 0)
+            cooldown--;
+        else if (smoothed > budgetMs * overBudget || (smoothed < budgetMs * underBudget && current < maxScale))
+        {
+            float wanted = current * std::sqrt(budgetMs / (std::max)(smoothed, 0.001f));
+            // always round down, a step too low is cheaper than a frame over budget
+            float snapped = std::floor(wanted / step + 0.001f) * step;
+            snapped = (std::min)((std::max)(snapped, minScale), maxScale);
+            if (std::fabs(snapped - current) >= step * 0.5f)
+            {
+                // the average belongs to the old scale, predict it for the new one instead of waiting for it to converge
+                smoothed *= (snapped * snapped) / (current * current);
+                current = snapped;
+                changed = true;
+                cooldown = cooldownFrames;
+            }
+        }
+
+        if (log)
+            log << frame << ',' << gpuMs << ',' << smoothed << ',' << current << ',' << (changed ? 1 : 0) << '\n';
+        return current;
+    }
+
+    float scale() const { return current; }
+    float smoothedMs() const { return smoothed; }
+
+    // returns to the maximum scale and forgets the measurements
+    void reset()
+    {
+        current = maxScale;
+        samples = 0;
+        smoothed = 0.0f;
+        cooldown = 0;
+    }
+
+private:
+    float current;
+    float smoothed = 0.0f;
+    unsigned long long frame = 0;
+    unsigned long long samples = 0;
+    unsigned int cooldown = 0;
+    std::ofstream log;
+};
+#endif
@@ -0,0 +1,176 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Helpers shared by the on-disk caches (cooked meshes, mip chains, ORM textures, IBL maps). A cache file is written
+// in native endianness and starts with a header whose first member is a CacheTag; the rest of the header holds a hash
+// of the source files (HashBytes / HashFile) and whatever settings the data depends on. A cache that doesn't match
+// in any of these is ignored and rebuilt from the sources.
+
+// identifies the kind and layout of a cache file. Bump the version of a cache whenever its layout or the processing
+// that produces the data changes.
+struct CacheTag {
+    char magic[4];
+    uint32_t version;
+
+    bool operator==(const CacheTag &other) const
+    {
+        return std::memcmp(magic, other.magic, sizeof(magic)) == 0 && version == other.version;
+    }
+    bool operator!=(const CacheTag &other) const { return !(*this == other); }
+};
+
+// read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile(const std::string &path) : data(nullptr), size(0)
+    {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+            return;
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL)
+            return;
+        data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data)
+            size = (size_t)fileSize.QuadPart;
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+            return;
+        void *ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED)
+            return;
+        data = (const unsigned char *)ptr;
+        size = (size_t)st.st_size;
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping != NULL)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (data)
+            munmap((void *)data, size);
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool valid() const { return data != nullptr; }
+
+    const unsigned char *data;
+    size_t size;
+
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int fd = -1;
+#endif
+};
+
+// 64 bit FNV-1a
+inline uint64_t HashBytes(const unsigned char *data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// hash of a file's content, 0 if it can't be read
+inline uint64_t HashFile(const std::string &path)
+{
+    MappedFile file(path);
+    if (!file.valid())
+        return 0;
+    return HashBytes(file.data, file.size);
+}
+
+// reads a whole file into bytes. Returns false (and leaves bytes empty) if it's missing, empty or can't be read.
+inline bool ReadFileBytes(const std::string &path, std::vector<unsigned char> &bytes)
+{
+    bytes.clear();
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+        return false;
+    std::streamoff size = in.tellg();
+    if (size <= 0)
+        return false;
+    bytes.resize((size_t)size);
+    in.seekg(0);
+    if (!in.read((char *)bytes.data(), size))
+    {
+        bytes.clear();
+        return false;
+    }
+    return true;
+}
+
+// closes a cache file written through out; if any write failed the partial file is removed, so it's never mistaken
+// for a valid cache. Returns whether the file was written completely.
+inline bool FinishCacheFile(std::ofstream &out, const std::string &path)
+{
+    bool written = (bool)out;
+    out.close();
+    if (!written || !out)
+    {
+        std::remove(path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// writes a cache held in memory (header included), see FinishCacheFile
+inline bool WriteCacheFile(const std::string &path, const std::vector<unsigned char> &bytes)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write((const char *)bytes.data(), bytes.size());
+    return FinishCacheFile(out, path);
+}
+
+inline double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+#endif
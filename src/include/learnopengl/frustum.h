@@ -0,0 +1,243 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_SIMD_WIDTH 4
+#else
+#define FRUSTUM_SIMD_WIDTH 1
+#endif
+
+// axis aligned box plus bounding sphere of a set of points, in the space the points are given in
+struct BoundingVolume {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+    glm::vec3 center = glm::vec3(0.0f);  // box center, also the sphere center
+    float radius = 0.0f;
+
+    glm::vec3 extents() const { return (max - min) * 0.5f; }
+};
+
+// bounds of count positions, stride is the distance between two positions in bytes
+inline BoundingVolume ComputeBounds(const void *positions, size_t count, size_t stride)
+{
+    BoundingVolume bounds;
+    if (count == 0)
+        return bounds;
+    const unsigned char *bytes = (const unsigned char *)positions;
+    bounds.min = bounds.max = *(const glm::vec3 *)bytes;
+    for (size_t i = 1; i < count; i++)
+    {
+        const glm::vec3 &p = *(const glm::vec3 *)(bytes + i * stride);
+        bounds.min = glm::min(bounds.min, p);
+        bounds.max = glm::max(bounds.max, p);
+    }
+    // sphere around the box center through the farthest point, tighter than the box diagonal
+    bounds.center = (bounds.min + bounds.max) * 0.5f;
+    float radius2 = 0.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 d = *(const glm::vec3 *)(bytes + i * stride) - bounds.center;
+        radius2 = (std::max)(radius2, glm::dot(d, d));
+    }
+    bounds.radius = std::sqrt(radius2);
+    return bounds;
+}
+
+struct Ray {
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);   // normalized
+};
+
+// world space ray through the window point (x, y), y pointing down as in glfw cursor coordinates
+inline Ray ScreenRay(float x, float y, float width, float height, const glm::mat4 &view, const glm::mat4 &projection)
+{
+    glm::mat4 inverse = glm::inverse(projection * view);
+    float ndcX = 2.0f * x / width - 1.0f, ndcY = 1.0f - 2.0f * y / height;
+    glm::vec4 nearPoint = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    Ray ray;
+    ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+    ray.direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - ray.origin);
+    return ray;
+}
+
+// Six planes (left, right, bottom, top, near, far) of a view frustum, normals pointing inside. Built from a
+// projection * view (* model) matrix, the planes are in the space that matrix transforms from, so passing the full
+// MVP gives object space planes that test a mesh's own bounds directly.
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum FromMatrix(const glm::mat4 &m)
+    {
+        // Gribb/Hartmann: rows of the matrix combined, glm is column major so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        Frustum frustum;
+        frustum.planes[0] = row3 + row0;
+        frustum.planes[1] = row3 - row0;
+        frustum.planes[2] = row3 + row1;
+        frustum.planes[3] = row3 - row1;
+        frustum.planes[4] = row3 + row2;
+        frustum.planes[5] = row3 - row2;
+        for (glm::vec4 &plane : frustum.planes)
+            plane /= glm::length(glm::vec3(plane));
+        return frustum;
+    }
+
+    // conservative: boxes crossing a frustum corner outside all planes together are kept
+    bool intersects(const glm::vec3 &center, const glm::vec3 &extents) const
+    {
+        for (const glm::vec4 &plane : planes)
+        {
+            glm::vec3 n(plane);
+            if (glm::dot(n, center) + glm::dot(glm::abs(n), extents) < -plane.w)
+                return false;
+        }
+        return true;
+    }
+
+    bool intersects(const BoundingVolume &bounds) const
+    {
+        return intersects(bounds.center, bounds.extents());
+    }
+
+    bool intersectsSphere(const glm::vec3 &center, float radius) const
+    {
+        for (const glm::vec4 &plane : planes)
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+                return false;
+        return true;
+    }
+};
+
+// Many boxes (center + half extents) in structure-of-arrays layout, tested against a frustum FRUSTUM_SIMD_WIDTH at a
+// time: 8 with AVX, 4 with SSE2, one by one otherwise. The arrays are padded to a multiple of 8, the padding is never
+// reported visible.
+class BoxCuller
+{
+public:
+    void clear()
+    {
+        count = 0;
+        forEachArray([](std::vector<float> &array) { array.clear(); });
+    }
+
+    void reserve(size_t boxes)
+    {
+        forEachArray([boxes](std::vector<float> &array) { array.reserve(padded(boxes)); });
+    }
+
+    // returns the index of the box, indices are handed out in order starting at 0
+    uint32_t add(const glm::vec3 &center, const glm::vec3 &extents)
+    {
+        if (count == centerX.size())
+        {
+            // grow by a full SIMD block, the unused lanes stay zero sized boxes at the origin
+            size_t size = count + 8;
+            forEachArray([size](std::vector<float> &array) { array.resize(size, 0.0f); });
+        }
+        centerX[count] = center.x; centerY[count] = center.y; centerZ[count] = center.z;
+        extentX[count] = extents.x; extentY[count] = extents.y; extentZ[count] = extents.z;
+        return (uint32_t)count++;
+    }
+
+    size_t size() const { return count; }
+
+    // writes the indices of the boxes touching the frustum to visible (in increasing order), returns their count
+    size_t cull(const Frustum &frustum, std::vector<uint32_t> &visible) const
+    {
+        visible.resize(count);
+        size_t visibleCount = 0;
+        size_t i = 0;
+#if FRUSTUM_SIMD_WIDTH == 8
+        for (; i < count; i += 8)
+        {
+            __m256 cx = _mm256_loadu_ps(&centerX[i]), cy = _mm256_loadu_ps(&centerY[i]), cz = _mm256_loadu_ps(&centerZ[i]);
+            __m256 ex = _mm256_loadu_ps(&extentX[i]), ey = _mm256_loadu_ps(&extentY[i]), ez = _mm256_loadu_ps(&extentZ[i]);
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (const glm::vec4 &plane : frustum.planes)
+            {
+                // distance of the center plus the projected radius of the box, outside if below -w
+                __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)),
+                    _mm256_mul_ps(cy, _mm256_set1_ps(plane.y))), _mm256_mul_ps(cz, _mm256_set1_ps(plane.z)));
+                __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(std::fabs(plane.x))),
+                    _mm256_mul_ps(ey, _mm256_set1_ps(std::fabs(plane.y)))), _mm256_mul_ps(ez, _mm256_set1_ps(std::fabs(plane.z))));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(d, r), _mm256_set1_ps(-plane.w), _CMP_GE_OQ));
+            }
+            visibleCount = emit((unsigned int)_mm256_movemask_ps(inside), i, visible, visibleCount);
+        }
+#elif FRUSTUM_SIMD_WIDTH == 4
+        for (; i < count; i += 4)
+        {
+            __m128 cx = _mm_loadu_ps(&centerX[i]), cy = _mm_loadu_ps(&centerY[i]), cz = _mm_loadu_ps(&centerZ[i]);
+            __m128 ex = _mm_loadu_ps(&extentX[i]), ey = _mm_loadu_ps(&extentY[i]), ez = _mm_loadu_ps(&extentZ[i]);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const glm::vec4 &plane : frustum.planes)
+            {
+                // distance of the center plus the projected radius of the box, outside if below -w
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)),
+                    _mm_mul_ps(cy, _mm_set1_ps(plane.y))), _mm_mul_ps(cz, _mm_set1_ps(plane.z)));
+                __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::fabs(plane.x))),
+                    _mm_mul_ps(ey, _mm_set1_ps(std::fabs(plane.y)))), _mm_mul_ps(ez, _mm_set1_ps(std::fabs(plane.z))));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), _mm_set1_ps(-plane.w)));
+            }
+            visibleCount = emit((unsigned int)_mm_movemask_ps(inside), i, visible, visibleCount);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            glm::vec3 center(centerX[i], centerY[i], centerZ[i]);
+            glm::vec3 extents(extentX[i], extentY[i], extentZ[i]);
+            if (frustum.intersects(center, extents))
+                visible[visibleCount++] = (uint32_t)i;
+        }
+        visible.resize(visibleCount);
+        return visibleCount;
+    }
+
+private:
+    size_t count = 0;
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    static size_t padded(size_t boxes) { return (boxes + 7) & ~(size_t)7; }
+
+    template <typename F>
+    void forEachArray(F f)
+    {
+        f(centerX); f(centerY); f(centerZ);
+        f(extentX); f(extentY); f(extentZ);
+    }
+
+    // appends the set lanes of a block starting at first, lanes past count are padding
+    size_t emit(unsigned int mask, size_t first, std::vector<uint32_t> &visible, size_t visibleCount) const
+    {
+        while (mask)
+        {
+            unsigned int lane = 0;
+            while (!(mask & (1u << lane)))
+                lane++;
+            mask &= mask - 1;
+            size_t index = first + lane;
+            if (index < count)
+                visible[visibleCount++] = (uint32_t)index;
+        }
+        return visibleCount;
+    }
+};
+#endif
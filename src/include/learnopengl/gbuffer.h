@@ -0,0 +1,94 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+// G-buffer for deferred PBR shading, 12 bytes per pixel:
+//
+//   material (attachment 0)  RGBA8    albedo.rgb, metallic
+//   normal   (attachment 1)  RGBA16   octahedral normal.xy (mapped to [0, 1]), roughness, ao
+//   depth                    DEPTH24  sampled by the lighting pass to rebuild the position
+//
+// The textures use nearest filtering and are meant to be read with texelFetch at gl_FragCoord. All calls must be
+// made on the GL context thread, release() before the context is destroyed.
+class GBuffer
+{
+public:
+    unsigned int fbo = 0;
+    unsigned int material = 0;
+    unsigned int normal = 0;
+    unsigned int depth = 0;
+    int width = 0, height = 0;
+
+    GBuffer() {}
+
+    GBuffer(const GBuffer &) = delete;
+    GBuffer &operator=(const GBuffer &) = delete;
+
+    // (re)creates the attachments if the size changed, zero sizes (minimized window) are ignored
+    void resize(int w, int h)
+    {
+        if (w <= 0 || h <= 0 || (w == width && h == height))
+            return;
+        release();
+        width = w;
+        height = h;
+
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        material = createTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, material, 0);
+        normal = createTexture(GL_RGBA16, GL_RGBA, GL_UNSIGNED_SHORT);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normal, 0);
+        depth = createTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+
+        unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, attachments);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::GBUFFER::Framebuffer not complete! " << width << "x" << height << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // binds material, normal and depth to firstUnit .. firstUnit + 2
+    void bindTextures(int firstUnit) const
+    {
+        unsigned int textures[3] = { material, normal, depth };
+        for (int i = 0; i < 3; i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+            glBindTexture(GL_TEXTURE_2D, textures[i]);
+        }
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    size_t bytes() const { return (size_t)width * height * 12; }
+
+    void release()
+    {
+        if (!fbo)
+            return;
+        unsigned int textures[3] = { material, normal, depth };
+        glDeleteTextures(3, textures);
+        glDeleteFramebuffers(1, &fbo);
+        fbo = material = normal = depth = 0;
+        width = height = 0;
+    }
+
+private:
+    unsigned int createTexture(GLenum internalFormat, GLenum format, GLenum type) const
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    }
+};
+#endif
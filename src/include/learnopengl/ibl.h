@@ -0,0 +1,652 @@
+#ifndef IBL_H
+#define IBL_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <learnopengl/file_cache.h>
+
+#include <stb_image.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+// Image based lighting from an equirectangular HDR environment: diffuse irradiance cubemap, GGX prefiltered specular
+// cubemap (roughness 0 .. 1 over the mip chain) and the split-sum BRDF lookup table. The convolutions run on the GPU
+// once and are cached to '<hdr path>.ibl'; later runs upload the cached texels directly.
+//
+// cache layout:
+//   IblCacheHeader
+//   irradiance   6 faces, irradianceSize^2 texels, RGB9E5 (GL_UNSIGNED_INT_5_9_9_9_REV)
+//   prefilter    per mip, 6 faces, (prefilterSize >> mip)^2 texels, RGB9E5
+//   brdf lut     lutSize^2 texels, RG16F
+//
+// The shader side expects samplers irradianceMap, prefilterMap (samplerCube), brdfLUT (sampler2D) and the float
+// prefilterMaxLod, see bind(). All calls must be made on the GL context thread, release() before the context is
+// destroyed.
+//
+// The cache version also covers the convolution shaders.
+const CacheTag IBL_CACHE_TAG = { { 'G', 'L', 'I', 'B' }, 1 };
+
+struct IblCacheHeader {
+    CacheTag tag;
+    uint64_t sourceHash;    // hash of the HDR file
+    uint32_t irradianceSize;
+    uint32_t prefilterSize;
+    uint32_t prefilterMips;
+    uint32_t lutSize;
+};
+
+class IBL
+{
+public:
+    unsigned int irradianceMap = 0;
+    unsigned int prefilterMap = 0;
+    unsigned int brdfLUT = 0;
+
+    int environmentSize = 512;  // intermediate cubemap the convolutions sample, not cached
+    int irradianceSize = 32;
+    int prefilterSize = 128;
+    int prefilterMips = 5;
+    int lutSize = 512;
+
+    IBL() {}
+
+    IBL(const IBL &) = delete;
+    IBL &operator=(const IBL &) = delete;
+
+    // loads the cache next to the HDR file or computes (and caches) the maps. If the HDR can't be read the maps
+    // are 1x1 and hold a constant dim ambient, so shaders keep working.
+    void load(const std::string &hdrPath)
+    {
+        release();
+        auto start = std::chrono::steady_clock::now();
+        glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+        std::vector<unsigned char> source;
+        if (!ReadFileBytes(hdrPath, source))
+        {
+            std::cout << "ERROR::IBL::can't read " << hdrPath << ", using a constant ambient" << std::endl;
+            createFallback();
+            return;
+        }
+        uint64_t sourceHash = HashBytes(source.data(), source.size());
+
+        const std::string cachePath = hdrPath + ".ibl";
+        std::vector<unsigned char> cache;
+        if (ReadFileBytes(cachePath, cache) && upload(cache, sourceHash))
+        {
+            std::cout << "IBL: " << hdrPath << " loaded from cache in " << ElapsedMs(start) << " ms" << std::endl;
+            return;
+        }
+
+        if (!compute(source, sourceHash, cache) || !upload(cache, sourceHash))
+        {
+            std::cout << "ERROR::IBL::can't decode " << hdrPath << ", using a constant ambient" << std::endl;
+            createFallback();
+            return;
+        }
+        if (!WriteCacheFile(cachePath, cache))
+            std::cout << "WARNING::IBL:: failed to write cache " << cachePath << std::endl;
+        std::cout << "IBL: " << hdrPath << " precomputed in " << ElapsedMs(start) << " ms" << std::endl;
+    }
+
+    // binds irradiance, prefilter and BRDF LUT to firstUnit .. firstUnit + 2 and sets the uniforms of the current program
+    void bind(GLuint program, int firstUnit)
+    {
+        // locations are looked up once per program
+        if (program != boundProgram)
+        {
+            const char *names[UNIFORM_COUNT] = { "irradianceMap", "prefilterMap", "brdfLUT", "prefilterMaxLod" };
+            for (int i = 0; i < UNIFORM_COUNT; i++)
+                locations[i] = glGetUniformLocation(program, names[i]);
+            boundProgram = program;
+        }
+
+        GLenum targets[3] = { GL_TEXTURE_CUBE_MAP, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D };
+        unsigned int textures[3] = { irradianceMap, prefilterMap, brdfLUT };
+        for (int i = 0; i < 3; i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+            glBindTexture(targets[i], textures[i]);
+            glUniform1i(locations[i], firstUnit + i);
+        }
+        glActiveTexture(GL_TEXTURE0);
+        glUniform1f(locations[3], (float)(loadedMips - 1));
+    }
+
+    void release()
+    {
+        unsigned int textures[3] = { irradianceMap, prefilterMap, brdfLUT };
+        if (irradianceMap)
+            glDeleteTextures(3, textures);
+        irradianceMap = prefilterMap = brdfLUT = 0;
+        boundProgram = 0;
+    }
+
+private:
+    static const int UNIFORM_COUNT = 4;
+
+    GLuint boundProgram = 0;
+    GLint locations[UNIFORM_COUNT];
+    int loadedMips = 1;
+
+    size_t expectedCacheSize() const
+    {
+        size_t bytes = sizeof(IblCacheHeader) + (size_t)6 * irradianceSize * irradianceSize * 4;
+        for (int mip = 0; mip < prefilterMips; mip++)
+        {
+            size_t size = (size_t)(std::max)(prefilterSize >> mip, 1);
+            bytes += 6 * size * size * 4;
+        }
+        return bytes + (size_t)lutSize * lutSize * 4;
+    }
+
+    // validates the cache against the source and the configured sizes and creates the textures from it
+    bool upload(const std::vector<unsigned char> &cache, uint64_t sourceHash)
+    {
+        if (cache.size() != expectedCacheSize())
+            return false;
+        const IblCacheHeader *header = (const IblCacheHeader *)cache.data();
+        if (header->tag != IBL_CACHE_TAG || header->sourceHash != sourceHash || header->irradianceSize != (uint32_t)irradianceSize ||
+            header->prefilterSize != (uint32_t)prefilterSize || header->prefilterMips != (uint32_t)prefilterMips ||
+            header->lutSize != (uint32_t)lutSize)
+            return false;
+
+        const unsigned char *texels = cache.data() + sizeof(IblCacheHeader);
+        irradianceMap = createCubemap(irradianceSize, 1, GL_RGB9_E5, GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV, &texels);
+        prefilterMap = createCubemap(prefilterSize, prefilterMips, GL_RGB9_E5, GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV, &texels);
+        brdfLUT = createTexture2D(lutSize, GL_RG16F, GL_RG, GL_HALF_FLOAT, texels);
+        loadedMips = prefilterMips;
+        return true;
+    }
+
+    // 1x1 maps standing in for a missing environment, close to the old flat vec3(0.03) ambient
+    void createFallback()
+    {
+        unsigned int ambient = packRGB9E5(0.03f);
+        const unsigned char *faces = (const unsigned char *)&ambient;
+        std::vector<unsigned char> six(6 * 4);
+        for (int i = 0; i < 6; i++)
+            std::memcpy(&six[i * 4], faces, 4);
+        const unsigned char *texels = six.data();
+        irradianceMap = createCubemap(1, 1, GL_RGB9_E5, GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV, &texels);
+        texels = six.data();
+        prefilterMap = createCubemap(1, 1, GL_RGB9_E5, GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV, &texels);
+        float lut[2] = { 1.0f, 0.0f };
+        brdfLUT = createTexture2D(1, GL_RG32F, GL_RG, GL_FLOAT, (const unsigned char *)lut);
+        loadedMips = 1;
+    }
+
+    // grey value in the shared exponent format, enough for the fallback
+    static unsigned int packRGB9E5(float value)
+    {
+        int exponent = 0;
+        float mantissa = std::frexp(value, &exponent);   // value = mantissa * 2^exponent, mantissa in [0.5, 1)
+        unsigned int m = (unsigned int)(mantissa * 512.0f + 0.5f);
+        unsigned int e = (unsigned int)(exponent + 15);  // m * 2^(e - 15 - 9) == mantissa * 2^exponent
+        if (m > 511)
+            m = 511;
+        return m | (m << 9) | (m << 18) | (e << 27);
+    }
+
+    // creates a cubemap from tightly packed 4 byte texels, face by face and mip by mip, advancing texels
+    static unsigned int createCubemap(int size, int mips, GLenum internalFormat, GLenum format, GLenum type, const unsigned char **texels)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+        for (int mip = 0; mip < mips; mip++)
+        {
+            int mipSize = (std::max)(size >> mip, 1);
+            for (int face = 0; face < 6; face++)
+            {
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, internalFormat, mipSize, mipSize, 0, format, type, texels ? *texels : NULL);
+                if (texels)
+                    *texels += (size_t)mipSize * mipSize * 4;
+            }
+        }
+        setCubemapParameters(mips);
+        return texture;
+    }
+
+    static void setCubemapParameters(int mips)
+    {
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, mips > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, mips - 1);
+    }
+
+    static unsigned int createTexture2D(int size, GLenum internalFormat, GLenum format, GLenum type, const unsigned char *texels)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, size, size, 0, format, type, texels);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return texture;
+    }
+
+    static unsigned int compileProgram(const char *vertexSource, const char *fragmentSource)
+    {
+        unsigned int program = glCreateProgram();
+        const char *sources[2] = { vertexSource, fragmentSource };
+        GLenum stages[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+        for (int i = 0; i < 2; i++)
+        {
+            unsigned int shader = glCreateShader(stages[i]);
+            glShaderSource(shader, 1, &sources[i], NULL);
+            glCompileShader(shader);
+            int success;
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                char infoLog[1024];
+                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::IBL::SHADER_COMPILATION_ERROR\n" << infoLog << std::endl;
+            }
+            glAttachShader(program, shader);
+            glDeleteShader(shader);
+        }
+        glLinkProgram(program);
+        int success;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            char infoLog[1024];
+            glGetProgramInfoLog(program, 1024, NULL, infoLog);
+            std::cout << "ERROR::IBL::PROGRAM_LINKING_ERROR\n" << infoLog << std::endl;
+        }
+        return program;
+    }
+
+    // runs the conversion and convolutions on the GPU and reads the results back into cache layout
+    bool compute(const std::vector<unsigned char> &source, uint64_t sourceHash, std::vector<unsigned char> &cache)
+    {
+        int width, height, components;
+        float *pixels = stbi_loadf_from_memory(source.data(), (int)source.size(), &width, &height, &components, 3);
+        if (!pixels)
+            return false;
+        // GL wants the bottom row first. Flipped here rather than with stbi_set_flip_vertically_on_load, which is
+        // process-global and would also flip images TextureStreamer decodes on its workers meanwhile.
+        for (int y = 0; y < height / 2; y++)
+            std::swap_ranges(pixels + (size_t)y * width * 3, pixels + (size_t)(y + 1) * width * 3, pixels + (size_t)(height - 1 - y) * width * 3);
+
+        GLint previousViewport[4];
+        glGetIntegerv(GL_VIEWPORT, previousViewport);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+
+        unsigned int equirectangular;
+        glGenTextures(1, &equirectangular);
+        glBindTexture(GL_TEXTURE_2D, equirectangular);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, pixels);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        stbi_image_free(pixels);
+
+        unsigned int captureFBO, cubeVAO, cubeVBO, emptyVAO;
+        glGenFramebuffers(1, &captureFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+        createCube(cubeVAO, cubeVBO);
+        glGenVertexArrays(1, &emptyVAO);
+
+        unsigned int equirectangularProgram = compileProgram(cubeVertexShaderSource(), equirectangularFragmentShaderSource());
+        unsigned int irradianceProgram = compileProgram(cubeVertexShaderSource(), irradianceFragmentShaderSource());
+        unsigned int prefilterProgram = compileProgram(cubeVertexShaderSource(),
+            (std::string("#version 330 core\n") + ggxSamplingShaderSource() + prefilterFragmentShaderSource()).c_str());
+        unsigned int brdfProgram = compileProgram(fullscreenVertexShaderSource(),
+            (std::string("#version 330 core\n") + ggxSamplingShaderSource() + brdfFragmentShaderSource()).c_str());
+
+        // 1. equirectangular map to cubemap, mipmapped so the prefilter pass can sample lower mips for rough lobes
+        int environmentMips = 1;
+        while ((environmentSize >> environmentMips) > 0)
+            environmentMips++;
+        unsigned int environment = createCubemap(environmentSize, environmentMips, GL_RGB16F, GL_RGB, GL_FLOAT, nullptr);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, equirectangular);
+        renderCube(equirectangularProgram, environment, environmentSize, 0, cubeVAO);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, environment);
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+
+        // 2. diffuse irradiance
+        unsigned int irradiance = createCubemap(irradianceSize, 1, GL_RGB16F, GL_RGB, GL_FLOAT, nullptr);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, environment);
+        renderCube(irradianceProgram, irradiance, irradianceSize, 0, cubeVAO);
+
+        // 3. GGX prefiltered specular, roughness = mip / (mips - 1)
+        unsigned int prefilter = createCubemap(prefilterSize, prefilterMips, GL_RGB16F, GL_RGB, GL_FLOAT, nullptr);
+        glUseProgram(prefilterProgram);
+        glUniform1f(glGetUniformLocation(prefilterProgram, "resolution"), (float)environmentSize);
+        for (int mip = 0; mip < prefilterMips; mip++)
+        {
+            glUniform1f(glGetUniformLocation(prefilterProgram, "roughness"), prefilterMips > 1 ? (float)mip / (prefilterMips - 1) : 0.0f);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, environment);
+            renderCube(prefilterProgram, prefilter, (std::max)(prefilterSize >> mip, 1), mip, cubeVAO);
+        }
+
+        // 4. BRDF integration LUT
+        unsigned int lut = createTexture2D(lutSize, GL_RG16F, GL_RG, GL_FLOAT, nullptr);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, lut, 0);
+        glViewport(0, 0, lutSize, lutSize);
+        glUseProgram(brdfProgram);
+        glUniform1f(glGetUniformLocation(brdfProgram, "size"), (float)lutSize);
+        glBindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        // read back in the compact formats, GL converts the half floats to RGB9E5 during the transfer
+        cache.assign(expectedCacheSize(), 0);
+        IblCacheHeader header;
+        header.tag = IBL_CACHE_TAG;
+        header.sourceHash = sourceHash;
+        header.irradianceSize = irradianceSize;
+        header.prefilterSize = prefilterSize;
+        header.prefilterMips = prefilterMips;
+        header.lutSize = lutSize;
+        std::memcpy(cache.data(), &header, sizeof(header));
+
+        GLint packAlignment;
+        glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        unsigned char *texels = cache.data() + sizeof(IblCacheHeader);
+        readCubemap(irradiance, irradianceSize, 1, &texels);
+        readCubemap(prefilter, prefilterSize, prefilterMips, &texels);
+        glBindTexture(GL_TEXTURE_2D, lut);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_HALF_FLOAT, texels);
+        glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+
+        unsigned int textures[5] = { equirectangular, environment, irradiance, prefilter, lut };
+        glDeleteTextures(5, textures);
+        glDeleteProgram(equirectangularProgram);
+        glDeleteProgram(irradianceProgram);
+        glDeleteProgram(prefilterProgram);
+        glDeleteProgram(brdfProgram);
+        glDeleteVertexArrays(1, &cubeVAO);
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteBuffers(1, &cubeVBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &captureFBO);
+        glBindVertexArray(0);
+        glUseProgram(0);
+        glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+        if (cullFace)
+            glEnable(GL_CULL_FACE);
+        return true;
+    }
+
+    // draws the unit cube into every face of a cubemap mip, the source texture must already be bound to unit 0
+    static void renderCube(unsigned int program, unsigned int cubemap, int size, int mip, unsigned int cubeVAO)
+    {
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
+        glm::mat4 views[6] = {
+            glm::lookAt(glm::vec3(0.0f), glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+            glm::lookAt(glm::vec3(0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+            glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
+            glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
+            glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+            glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
+        };
+
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, "source"), 0);
+        glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        glViewport(0, 0, size, size);
+        glBindVertexArray(cubeVAO);
+        for (int face = 0; face < 6; face++)
+        {
+            glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(views[face]));
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, cubemap, mip);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+        }
+    }
+
+    static void readCubemap(unsigned int cubemap, int size, int mips, unsigned char **texels)
+    {
+        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+        for (int mip = 0; mip < mips; mip++)
+        {
+            int mipSize = (std::max)(size >> mip, 1);
+            for (int face = 0; face < 6; face++)
+            {
+                glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV, *texels);
+                *texels += (size_t)mipSize * mipSize * 4;
+            }
+        }
+    }
+
+    static void createCube(unsigned int &vao, unsigned int &vbo)
+    {
+        const float v[] = {
+            -1, -1, -1,   1,  1, -1,   1, -1, -1,    1,  1, -1,  -1, -1, -1,  -1,  1, -1,  // back
+            -1, -1,  1,   1, -1,  1,   1,  1,  1,    1,  1,  1,  -1,  1,  1,  -1, -1,  1,  // front
+            -1,  1,  1,  -1,  1, -1,  -1, -1, -1,   -1, -1, -1,  -1, -1,  1,  -1,  1,  1,  // left
+             1,  1,  1,   1, -1, -1,   1,  1, -1,    1, -1, -1,   1,  1,  1,   1, -1,  1,  // right
+            -1, -1, -1,   1, -1, -1,   1, -1,  1,    1, -1,  1,  -1, -1,  1,  -1, -1, -1,  // bottom
+            -1,  1, -1,   1,  1,  1,   1,  1, -1,    1,  1,  1,  -1,  1, -1,  -1,  1,  1   // top
+        };
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    static const char *cubeVertexShaderSource()
+    {
+        return R"glsl(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+out vec3 localPos;
+uniform mat4 projection;
+uniform mat4 view;
+void main() {
+    localPos = aPos;
+    gl_Position = projection * view * vec4(aPos, 1.0);
+}
+)glsl";
+    }
+
+    static const char *fullscreenVertexShaderSource()
+    {
+        return R"glsl(
+#version 330 core
+void main() {
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)glsl";
+    }
+
+    static const char *equirectangularFragmentShaderSource()
+    {
+        return R"glsl(
+#version 330 core
+in vec3 localPos;
+out vec4 FragColor;
+uniform sampler2D source;
+const vec2 invAtan = vec2(0.1591, 0.3183);
+void main() {
+    vec3 v = normalize(localPos);
+    vec2 uv = vec2(atan(v.z, v.x), asin(v.y)) * invAtan + 0.5;
+    FragColor = vec4(texture(source, uv).rgb, 1.0);
+}
+)glsl";
+    }
+
+    static const char *irradianceFragmentShaderSource()
+    {
+        return R"glsl(
+#version 330 core
+in vec3 localPos;
+out vec4 FragColor;
+uniform samplerCube source;
+const float PI = 3.14159265359;
+void main() {
+    vec3 N = normalize(localPos);
+    vec3 up = abs(N.y) < 0.999 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 right = normalize(cross(up, N));
+    up = cross(N, right);
+
+    // cosine weighted hemisphere integral, Riemann sum over spherical coordinates
+    vec3 irradiance = vec3(0.0);
+    float samples = 0.0;
+    float delta = 0.025;
+    for (float phi = 0.0; phi < 2.0 * PI; phi += delta) {
+        for (float theta = 0.0; theta < 0.5 * PI; theta += delta) {
+            vec3 tangent = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+            vec3 direction = tangent.x * right + tangent.y * up + tangent.z * N;
+            irradiance += texture(source, direction).rgb * cos(theta) * sin(theta);
+            samples++;
+        }
+    }
+    FragColor = vec4(PI * irradiance / samples, 1.0);
+}
+)glsl";
+    }
+
+    // shared by the prefilter and BRDF passes, inserted after the #version line
+    static const char *ggxSamplingShaderSource()
+    {
+        return R"glsl(
+const float PI = 3.14159265359;
+
+float RadicalInverse(uint bits) {
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return float(bits) * 2.3283064365386963e-10;
+}
+
+vec2 Hammersley(uint i, uint count) {
+    return vec2(float(i) / float(count), RadicalInverse(i));
+}
+
+vec3 ImportanceSampleGGX(vec2 Xi, vec3 N, float roughness) {
+    float a = roughness * roughness;
+    float phi = 2.0 * PI * Xi.x;
+    float cosTheta = sqrt((1.0 - Xi.y) / (1.0 + (a * a - 1.0) * Xi.y));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+    vec3 H = vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+
+    vec3 up = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, N));
+    vec3 bitangent = cross(N, tangent);
+    return normalize(tangent * H.x + bitangent * H.y + N * H.z);
+}
+)glsl";
+    }
+
+    static const char *prefilterFragmentShaderSource()
+    {
+        return R"glsl(
+in vec3 localPos;
+out vec4 FragColor;
+uniform samplerCube source;
+uniform float roughness;
+uniform float resolution;   // face size of the source cubemap
+
+float DistributionGGX(float NdotH, float roughness) {
+    float a = roughness * roughness;
+    float a2 = a * a;
+    float denom = NdotH * NdotH * (a2 - 1.0) + 1.0;
+    return a2 / (PI * denom * denom);
+}
+
+void main() {
+    // N = V = R, the usual split-sum simplification
+    vec3 N = normalize(localPos);
+    vec3 V = N;
+
+    const uint SAMPLE_COUNT = 1024u;
+    vec3 color = vec3(0.0);
+    float weight = 0.0;
+    for (uint i = 0u; i < SAMPLE_COUNT; ++i) {
+        vec3 H = ImportanceSampleGGX(Hammersley(i, SAMPLE_COUNT), N, roughness);
+        vec3 L = normalize(2.0 * dot(V, H) * H - V);
+        float NdotL = max(dot(N, L), 0.0);
+        if (NdotL > 0.0) {
+            // sample a lower source mip where the pdf is low, avoids bright dots from undersampling
+            float NdotH = max(dot(N, H), 0.0);
+            float HdotV = max(dot(H, V), 0.0);
+            float pdf = DistributionGGX(NdotH, roughness) * NdotH / (4.0 * HdotV) + 0.0001;
+            float saTexel = 4.0 * PI / (6.0 * resolution * resolution);
+            float saSample = 1.0 / (float(SAMPLE_COUNT) * pdf + 0.0001);
+            float mip = roughness == 0.0 ? 0.0 : 0.5 * log2(saSample / saTexel);
+
+            color += textureLod(source, L, mip).rgb * NdotL;
+            weight += NdotL;
+        }
+    }
+    FragColor = vec4(color / weight, 1.0);
+}
+)glsl";
+    }
+
+    static const char *brdfFragmentShaderSource()
+    {
+        return R"glsl(
+out vec2 FragColor;
+uniform float size;
+
+float GeometrySchlickGGX(float NdotV, float roughness) {
+    // k for IBL differs from the analytic lights
+    float k = (roughness * roughness) / 2.0;
+    return NdotV / (NdotV * (1.0 - k) + k);
+}
+
+void main() {
+    float NdotV = gl_FragCoord.x / size;
+    float roughness = gl_FragCoord.y / size;
+    vec3 V = vec3(sqrt(1.0 - NdotV * NdotV), 0.0, NdotV);
+    vec3 N = vec3(0.0, 0.0, 1.0);
+
+    const uint SAMPLE_COUNT = 1024u;
+    float A = 0.0;
+    float B = 0.0;
+    for (uint i = 0u; i < SAMPLE_COUNT; ++i) {
+        vec3 H = ImportanceSampleGGX(Hammersley(i, SAMPLE_COUNT), N, roughness);
+        vec3 L = normalize(2.0 * dot(V, H) * H - V);
+        float NdotL = max(L.z, 0.0);
+        float NdotH = max(H.z, 0.0);
+        float VdotH = max(dot(V, H), 0.0);
+        if (NdotL > 0.0) {
+            float G = GeometrySchlickGGX(NdotV, roughness) * GeometrySchlickGGX(NdotL, roughness);
+            float G_Vis = (G * VdotH) / (NdotH * NdotV);
+            float Fc = pow(1.0 - VdotH, 5.0);
+            A += (1.0 - Fc) * G_Vis;
+            B += Fc * G_Vis;
+        }
+    }
+    FragColor = vec2(A, B) / float(SAMPLE_COUNT);
+}
+)glsl";
+    }
+};
+#endif
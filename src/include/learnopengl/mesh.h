@@ -5,8 +5,11 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/frustum.h>
 
 #include <string>
 #include <fstream>
@@ -28,10 +31,110 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// layout of the vertex buffer on the GPU
+enum VertexFormat {
+    VERTEX_FLOAT,   // Vertex as is, 56 bytes
+    VERTEX_PACKED   // PackedVertex, 24 bytes. Shaders have to decode it, see src/shader/packed_mesh.vert
+};
+
+// quantized vertex: the normal is octahedral encoded in 2x16 bit snorm, the tangent octahedral encoded in 10:10
+// with the bitangent sign in the 2 bit w, uvs are half floats. The bitangent is rebuilt in the shader.
+// the position stays float, half precision is too coarse for models a few units in size.
+struct PackedVertex {
+    glm::vec3 Position;
+    glm::uint32 TexCoords;  // 2x half
+    glm::uint32 Normal;     // 2x snorm16, octahedral
+    glm::uint32 Tangent;    // snorm 10:10:10:2 -> octahedral xy, unused z, bitangent sign
+};
+
+// maps a unit vector onto the [-1, 1]^2 octahedron
+inline glm::vec2 OctahedralEncode(glm::vec3 n)
+{
+    n /= (glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z));
+    glm::vec2 p(n.x, n.y);
+    if (n.z < 0.0f)
+        p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * glm::vec2(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+    return p;
+}
+
+inline PackedVertex PackVertex(const Vertex &v)
+{
+    PackedVertex p;
+    p.Position = v.Position;
+    p.TexCoords = glm::packHalf2x16(v.TexCoords);
+    p.Normal = glm::packSnorm2x16(OctahedralEncode(v.Normal));
+    // degenerate tangents (meshes without uvs) would divide by zero in the encoding
+    glm::vec2 tangent = glm::dot(v.Tangent, v.Tangent) > 0.0f ? OctahedralEncode(v.Tangent) : glm::vec2(0.0f);
+    float sign = glm::dot(glm::cross(v.Normal, v.Tangent), v.Bitangent) < 0.0f ? -1.0f : 1.0f;
+    p.Tangent = glm::packSnorm3x10_1x2(glm::vec4(tangent, 0.0f, sign));
+    return p;
+}
+
+// owning handle of a texture. Textures from the TextureRegistry hold one registry reference,
+// any other texture id is deleted with the handle. Move-only, use share() for another reference
+// (registry textures only, other ids have no reference count to share).
 struct Texture {
-    unsigned int id;
+    unsigned int id = 0;
     string type;
     string path;
+
+    Texture() = default;
+    Texture(const Texture &) = delete;
+    Texture &operator=(const Texture &) = delete;
+
+    Texture(Texture &&other) noexcept : id(other.id), type(std::move(other.type)), path(std::move(other.path))
+    {
+        other.id = 0;
+    }
+
+    Texture &operator=(Texture &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            id = other.id;
+            type = std::move(other.type);
+            path = std::move(other.path);
+            other.id = 0;
+        }
+        return *this;
+    }
+
+    ~Texture()
+    {
+        reset();
+    }
+
+    // a second handle on the same registry texture. For an id the registry doesn't know the new handle is empty
+    // (id 0), since two handles owning it would both delete it.
+    Texture share() const
+    {
+        Texture texture;
+        texture.id = id != 0 ? TextureRegistry::instance().retain(id) : 0;
+        texture.type = type;
+        texture.path = path;
+        return texture;
+    }
+
+    void reset()
+    {
+        if (id != 0 && !TextureRegistry::instance().release(id))
+            glDeleteTextures(1, &id);
+        id = 0;
+    }
+};
+
+// a texture reference found in a material, resolved to a GL texture on the context thread
+struct TextureRef {
+    string type;
+    string path;
+};
+
+// CPU-side result of converting a single aiMesh. Filled on worker threads, turned into a Mesh afterwards.
+struct MeshData {
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+    vector<TextureRef> textures;
 };
 
 class Mesh {
@@ -41,51 +144,83 @@ public:
     vector<unsigned int> indices;
     vector<Texture> textures;
     unsigned int VAO;
+    unsigned int indexCount;
+    VertexFormat format;
+    size_t vertexBytes;     // size of the vertex buffer on the GPU
+    BoundingVolume bounds;  // model space box and sphere of the vertex positions, for culling
 
     /*  Functions  */
     // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, VertexFormat format = VERTEX_FLOAT)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), format(format)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+    }
+
+    // constructor for data that already lives in memory (e.g. a mapped cooked mesh file).
+    // the data is handed straight to the GPU and not copied into the vertices/indices vectors.
+    Mesh(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount, vector<Texture> textures, VertexFormat format = VERTEX_FLOAT)
+        : textures(std::move(textures)), format(format)
+    {
+        setupMesh(vertexData, vertexCount, indexData, indexCount);
+    }
+
+    // a mesh owns its GL objects: move-only, and they are deleted with the mesh
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+
+    Mesh(Mesh &&other) noexcept
+        : vertices(std::move(other.vertices)), indices(std::move(other.indices)), textures(std::move(other.textures)),
+          VAO(other.VAO), indexCount(other.indexCount), format(other.format), vertexBytes(other.vertexBytes),
+          bounds(other.bounds), VBO(other.VBO), EBO(other.EBO), samplerNames(std::move(other.samplerNames))
+    {
+        other.VAO = other.VBO = other.EBO = 0;
+    }
+
+    Mesh &operator=(Mesh &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            vertices = std::move(other.vertices);
+            indices = std::move(other.indices);
+            textures = std::move(other.textures);
+            VAO = other.VAO;
+            indexCount = other.indexCount;
+            format = other.format;
+            vertexBytes = other.vertexBytes;
+            bounds = other.bounds;
+            VBO = other.VBO;
+            EBO = other.EBO;
+            samplerNames = std::move(other.samplerNames);
+            other.VAO = other.VBO = other.EBO = 0;
+        }
+        return *this;
+    }
+
+    ~Mesh()
+    {
+        release();
     }
 
     // render the mesh
-    void Draw(Shader shader) 
+    void Draw(const Shader &shader) 
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
+        // bind appropriate textures, the sampler names were hashed when the mesh was created
         for(unsigned int i = 0; i < textures.size(); i++)
         {
             glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-				number = std::to_string(diffuseNr++);
-			else if(name == "texture_specular")
-				number = std::to_string(specularNr++); // transfer unsigned int to stream
-            else if(name == "texture_normal")
-				number = std::to_string(normalNr++); // transfer unsigned int to stream
-             else if(name == "texture_height")
-			    number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-													 // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+            // now set the sampler to the correct texture unit
+            glUniform1i(shader.location(samplerNames[i]), i);
             // and finally bind the texture
             glBindTexture(GL_TEXTURE_2D, textures[i].id);
         }
         
         // draw mesh
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
@@ -95,11 +230,50 @@ public:
 private:
     /*  Render data  */
     unsigned int VBO, EBO;
+    vector<UniformName> samplerNames;   // 'texture_diffuseN' etc. for every texture
+
+    // names the samplers by the convention texture_diffuseN, texture_specularN, texture_normalN, texture_heightN
+    void setupSamplerNames()
+    {
+        unsigned int diffuseNr  = 1;
+        unsigned int specularNr = 1;
+        unsigned int normalNr   = 1;
+        unsigned int heightNr   = 1;
+        samplerNames.clear();
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            // retrieve texture number (the N in diffuse_textureN)
+            string number;
+            string name = textures[i].type;
+            if(name == "texture_diffuse")
+                number = std::to_string(diffuseNr++);
+            else if(name == "texture_specular")
+                number = std::to_string(specularNr++);
+            else if(name == "texture_normal")
+                number = std::to_string(normalNr++);
+            else if(name == "texture_height")
+                number = std::to_string(heightNr++);
+            samplerNames.push_back(UniformName(name + number));
+        }
+    }
 
     /*  Functions    */
+    // deletes the GL objects (zero names are silently ignored by GL)
+    void release()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+    }
+
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount)
     {
+        this->indexCount = (unsigned int)indexCount;
+        bounds = ComputeBounds(vertexData, vertexCount, sizeof(Vertex));
+        setupSamplerNames();
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
@@ -108,30 +282,61 @@ private:
         glBindVertexArray(VAO);
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+        if (format == VERTEX_PACKED)
+        {
+            vector<PackedVertex> packed(vertexCount);
+            for (size_t i = 0; i < vertexCount; i++)
+                packed[i] = PackVertex(vertexData[i]);
+            vertexBytes = vertexCount * sizeof(PackedVertex);
+            glBufferData(GL_ARRAY_BUFFER, vertexBytes, packed.data(), GL_STATIC_DRAW);
+        }
+        else
+        {
+            // A great thing about structs is that their memory layout is sequential for all its items.
+            // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
+            // again translates to 3/2 floats which translates to a byte array.
+            vertexBytes = vertexCount * sizeof(Vertex);
+            glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
+        }
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
 
         // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);	
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);	
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);	
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        if (format == VERTEX_PACKED)
+        {
+            // vertex Positions
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)0);
+            // vertex normals, octahedral
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+            // vertex texture coords
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+            // vertex tangent, octahedral xy + bitangent sign in w
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Tangent));
+            // no bitangent attribute, it is rebuilt from normal, tangent and sign
+        }
+        else
+        {
+            // vertex Positions
+            glEnableVertexAttribArray(0);	
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+            // vertex normals
+            glEnableVertexAttribArray(1);	
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+            // vertex texture coords
+            glEnableVertexAttribArray(2);	
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+            // vertex tangent
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+            // vertex bitangent
+            glEnableVertexAttribArray(4);
+            glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        }
 
         glBindVertexArray(0);
     }
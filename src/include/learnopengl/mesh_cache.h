@@ -0,0 +1,182 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/file_cache.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <vector>
+
+// Cooked mesh files store the final Vertex/index arrays and texture references of a Model, so later runs can skip
+// assimp entirely. The file is mapped read-only and the arrays are handed straight to glBufferData.
+//
+// layout (every block 4 byte aligned):
+//   CookedHeader
+//   per mesh: CookedMeshHeader, Vertex[vertexCount], uint32[indexCount],
+//             per texture: uint32 typeLength, uint32 pathLength, type chars, path chars, padding to 4 bytes
+const CacheTag COOKED_MESH_TAG = { { 'G', 'L', 'S', 'M' }, 1 };
+
+struct CookedHeader {
+    CacheTag tag;
+    uint32_t importFlags;   // assimp post-processing flags the data was produced with
+    uint32_t vertexSize;    // sizeof(Vertex), guards against layout changes of the struct
+    uint64_t sourceHash;    // hash of the source model file and its material files, see HashModelSources
+    uint32_t meshCount;
+    uint32_t reserved;
+};
+
+struct CookedMeshHeader {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t textureCount;
+    uint32_t reserved;
+};
+
+// a mesh inside a mapped cooked file. The pointers stay valid as long as the MappedFile is alive.
+struct CookedMeshView {
+    const Vertex *vertices;
+    uint32_t vertexCount;
+    const unsigned int *indices;
+    uint32_t indexCount;
+    vector<TextureRef> textures;
+};
+
+// hash of a model file plus the files it pulls its materials (and so the texture references) from, 0 if the model
+// can't be read. Only OBJ has such files: every 'mtllib' is hashed, relative to the model's directory. A missing
+// material library still changes the hash, so creating it later invalidates the cooked file as well.
+inline uint64_t HashModelSources(const string &path)
+{
+    MappedFile file(path);
+    if (!file.valid())
+        return 0;
+    uint64_t hash = HashBytes(file.data, file.size);
+
+    string extension = path.substr(path.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    if (extension != "obj")
+        return hash;
+
+    const string directory = path.substr(0, path.find_last_of('/') + 1);
+    const char *text = (const char *)file.data, *end = text + file.size;
+    while (text < end)
+    {
+        const char *lineEnd = std::find(text, end, '\n');
+        const char *p = text;
+        while (p < lineEnd && (*p == ' ' || *p == '\t'))
+            p++;
+        if (lineEnd - p > 7 && std::strncmp(p, "mtllib", 6) == 0 && (p[6] == ' ' || p[6] == '\t'))
+        {
+            // the rest of the line is the file name
+            const char *nameBegin = p + 7, *nameEnd = lineEnd;
+            while (nameBegin < nameEnd && (*nameBegin == ' ' || *nameBegin == '\t'))
+                nameBegin++;
+            while (nameEnd > nameBegin && (nameEnd[-1] == ' ' || nameEnd[-1] == '\t' || nameEnd[-1] == '\r'))
+                nameEnd--;
+            string name(nameBegin, nameEnd);
+            hash = HashBytes((const unsigned char *)name.data(), name.size(), hash);
+
+            MappedFile material(directory + name);
+            if (material.valid())
+                hash = HashBytes(material.data, material.size, hash);
+            else
+                hash = HashBytes((const unsigned char *)"missing", 7, hash);
+        }
+        text = lineEnd + 1;
+    }
+    return hash;
+}
+
+// writes the processed meshes of a model to a cooked file. Returns false (and leaves no usable file) on failure.
+inline bool WriteCookedMeshes(const string &path, uint64_t sourceHash, uint32_t importFlags, const vector<MeshData> &meshes)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    CookedHeader header;
+    header.tag = COOKED_MESH_TAG;
+    header.importFlags = importFlags;
+    header.vertexSize = sizeof(Vertex);
+    header.sourceHash = sourceHash;
+    header.meshCount = (uint32_t)meshes.size();
+    header.reserved = 0;
+    out.write((const char *)&header, sizeof(header));
+
+    const char padding[4] = { 0, 0, 0, 0 };
+    for (const MeshData &mesh : meshes)
+    {
+        CookedMeshHeader meshHeader;
+        meshHeader.vertexCount = (uint32_t)mesh.vertices.size();
+        meshHeader.indexCount = (uint32_t)mesh.indices.size();
+        meshHeader.textureCount = (uint32_t)mesh.textures.size();
+        meshHeader.reserved = 0;
+        out.write((const char *)&meshHeader, sizeof(meshHeader));
+        out.write((const char *)mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+        out.write((const char *)mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+        for (const TextureRef &ref : mesh.textures)
+        {
+            uint32_t lengths[2] = { (uint32_t)ref.type.size(), (uint32_t)ref.path.size() };
+            out.write((const char *)lengths, sizeof(lengths));
+            out.write(ref.type.data(), ref.type.size());
+            out.write(ref.path.data(), ref.path.size());
+            out.write(padding, (4 - (lengths[0] + lengths[1]) % 4) % 4);
+        }
+    }
+    return FinishCacheFile(out, path);
+}
+
+// validates a mapped cooked file against the expected source hash / import flags and collects its meshes.
+// returns false if the file is stale, from another version or truncated; the caller then falls back to assimp.
+inline bool ReadCookedMeshes(const MappedFile &file, uint64_t sourceHash, uint32_t importFlags, vector<CookedMeshView> &meshes)
+{
+    size_t offset = 0;
+    auto take = [&](size_t bytes) -> const unsigned char *
+    {
+        if (bytes > file.size - offset)
+            return nullptr;
+        const unsigned char *ptr = file.data + offset;
+        offset += bytes;
+        return ptr;
+    };
+
+    const CookedHeader *header = (const CookedHeader *)take(sizeof(CookedHeader));
+    if (!header || header->tag != COOKED_MESH_TAG || header->vertexSize != sizeof(Vertex) ||
+        header->importFlags != importFlags || header->sourceHash != sourceHash)
+        return false;
+
+    meshes.clear();
+    meshes.reserve((std::min)((size_t)header->meshCount, file.size / sizeof(CookedMeshHeader)));
+    for (uint32_t i = 0; i < header->meshCount; i++)
+    {
+        const CookedMeshHeader *meshHeader = (const CookedMeshHeader *)take(sizeof(CookedMeshHeader));
+        if (!meshHeader)
+            return false;
+        CookedMeshView view;
+        view.vertexCount = meshHeader->vertexCount;
+        view.indexCount = meshHeader->indexCount;
+        view.vertices = (const Vertex *)take((size_t)view.vertexCount * sizeof(Vertex));
+        view.indices = (const unsigned int *)take((size_t)view.indexCount * sizeof(unsigned int));
+        if (!view.vertices || !view.indices)
+            return false;
+        for (uint32_t t = 0; t < meshHeader->textureCount; t++)
+        {
+            const uint32_t *lengths = (const uint32_t *)take(2 * sizeof(uint32_t));
+            if (!lengths)
+                return false;
+            size_t padded = (size_t)lengths[0] + lengths[1];
+            padded += (4 - padded % 4) % 4;
+            const char *chars = (const char *)take(padded);
+            if (!chars)
+                return false;
+            view.textures.push_back({ string(chars, lengths[0]), string(chars + lengths[0], lengths[1]) });
+        }
+        meshes.push_back(std::move(view));
+    }
+    return true;
+}
+#endif
@@ -0,0 +1,132 @@
+#ifndef MIP_CACHE_H
+#define MIP_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/file_cache.h>
+
+#include <stb_image.h>
+#include <image_helper.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <iostream>
+#include <vector>
+
+// Full mip chain of an image file, filtered on the CPU by build_mipmap_chain (image_helper.c, needs to be compiled
+// into the target) instead of glGenerateMipmap: sRGB color is filtered in linear space, normal maps are
+// renormalized and alpha tested cutouts keep their coverage, depending on the MIPMAP_* flags. The chain is cached
+// to '<file>.mips' and reused as long as the image file and the flags are unchanged, so later runs neither decode
+// nor filter the image.
+//
+// cache layout:
+//   MipCacheHeader
+//   the chain as written by build_mipmap_chain: level 0 then every smaller level, channels bytes per texel
+// The version also covers the filtering in build_mipmap_chain.
+const CacheTag MIP_CACHE_TAG = { { 'G', 'L', 'M', 'P' }, 1 };
+
+struct MipCacheHeader {
+    CacheTag tag;
+    uint64_t sourceHash;    // hash of the image file
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t levels;
+    uint32_t flags;         // MIPMAP_* flags the chain was built with
+    uint32_t filter;        // MIPMAP_FILTER_*
+};
+
+class MipChain
+{
+public:
+    int width = 0, height = 0, channels = 0, levels = 0;
+    std::vector<unsigned char> data;    // cache header followed by the chain
+
+    // loads the chain of an image from its cache, or builds it and writes the cache. Returns false if the image
+    // can't be read.
+    bool load(const std::string &filename, int flags, int filter = MIPMAP_FILTER_KAISER)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<unsigned char> file;
+        if (!ReadFileBytes(filename, file))
+            return false;
+        uint64_t sourceHash = HashBytes(file.data(), file.size());
+
+        const std::string cachePath = filename + ".mips";
+        if (ReadFileBytes(cachePath, data) && validCache(sourceHash, flags, filter))
+        {
+            std::cout << "MipChain: " << filename << " loaded from cache in " << ElapsedMs(start) << " ms" << std::endl;
+            return true;
+        }
+
+        unsigned char *pixels = stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &channels, 0);
+        if (!pixels)
+            return false;
+        data.assign(sizeof(MipCacheHeader) + mipmap_chain_size(width, height, channels), 0);
+        levels = build_mipmap_chain(pixels, width, height, channels, filter, flags, data.data() + sizeof(MipCacheHeader));
+        stbi_image_free(pixels);
+        if (levels == 0)
+        {
+            data.clear();
+            return false;
+        }
+
+        MipCacheHeader *header = (MipCacheHeader *)data.data();
+        header->tag = MIP_CACHE_TAG;
+        header->sourceHash = sourceHash;
+        header->width = (uint32_t)width;
+        header->height = (uint32_t)height;
+        header->channels = (uint32_t)channels;
+        header->levels = (uint32_t)levels;
+        header->flags = (uint32_t)flags;
+        header->filter = (uint32_t)filter;
+
+        if (!WriteCacheFile(cachePath, data))
+            std::cout << "WARNING::MIPCHAIN:: failed to write cache " << cachePath << std::endl;
+        std::cout << "MipChain: " << filename << " filtered " << width << "x" << height << " in " << ElapsedMs(start) << " ms" << std::endl;
+        return true;
+    }
+
+    // specifies every level of the texture bound to GL_TEXTURE_2D
+    void upload() const
+    {
+        GLenum format = channels == 1 ? GL_RED : channels == 2 ? GL_RG : channels == 3 ? GL_RGB : GL_RGBA;
+        // small levels of RGB images have rows that aren't a multiple of 4 bytes
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        const unsigned char *level = data.data() + sizeof(MipCacheHeader);
+        int w = width, h = height;
+        for (int i = 0; i < levels; i++)
+        {
+            glTexImage2D(GL_TEXTURE_2D, i, format, w, h, 0, format, GL_UNSIGNED_BYTE, level);
+            level += (size_t)w * h * channels;
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    }
+
+private:
+    // checks the cache just read into data, taking the sizes from it when it's usable
+    bool validCache(uint64_t sourceHash, int flags, int filter)
+    {
+        if (data.size() < sizeof(MipCacheHeader))
+            return false;
+        const MipCacheHeader *header = (const MipCacheHeader *)data.data();
+        if (header->tag != MIP_CACHE_TAG || header->sourceHash != sourceHash || header->flags != (uint32_t)flags || header->filter != (uint32_t)filter ||
+            header->width == 0 || header->height == 0 || header->channels == 0 || header->channels > 4 ||
+            header->width > 65536 || header->height > 65536)
+            return false;
+        int w = (int)header->width, h = (int)header->height, c = (int)header->channels;
+        if (header->levels != (uint32_t)mipmap_chain_levels(w, h) ||
+            data.size() != sizeof(MipCacheHeader) + (size_t)mipmap_chain_size(w, h, c))
+            return false;
+        width = w;
+        height = h;
+        channels = c;
+        levels = (int)header->levels;
+        return true;
+    }
+};
+#endif
@@ -11,6 +11,10 @@
 #include <assimp/postprocess.h>
 
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/texture_streamer.h>
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/mip_cache.h>
 #include <learnopengl/shader.h>
 
 #include <string>
@@ -18,80 +22,196 @@
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false, int mipFlags = MIPMAP_WRAP);
 
 class Model 
 {
 public:
     /*  Model Data */
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    vector<Texture> textures_loaded;	// one handle per distinct texture of the model, meshes hold shared handles.
     vector<Mesh> meshes;
     string directory;
     bool gammaCorrection;
+    bool streamTextures;	// textures are decoded in the background, call TextureStreamer::instance().update() every frame
+    VertexFormat vertexFormat;	// VERTEX_PACKED needs a shader decoding PackedVertex
 
     /*  Functions   */
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, bool stream = false, VertexFormat format = VERTEX_FLOAT) : gammaCorrection(gamma), streamTextures(stream), vertexFormat(format)
     {
         loadModel(path);
     }
 
+    // meshes and textures are move-only handles, and so is the model
+    Model(const Model &) = delete;
+    Model &operator=(const Model &) = delete;
+    Model(Model &&) = default;
+    Model &operator=(Model &&) = default;
+
     // draws the model, and thus all its meshes
-    void Draw(Shader shader)
+    void Draw(const Shader &shader)
     {
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
+
+    // draws only the meshes whose bounds touch the frustum, build it from projection * view * model so it is in
+    // model space. Returns the number of meshes drawn.
+    unsigned int Draw(const Shader &shader, const Frustum &frustum)
+    {
+        unsigned int drawn = 0;
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            if (!frustum.intersects(meshes[i].bounds))
+                continue;
+            meshes[i].Draw(shader);
+            drawn++;
+        }
+        return drawn;
+    }
     
 private:
     /*  Functions   */
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    // the processed meshes are cooked to '<path>.cooked'; later runs map that file instead of running assimp again
+    // as long as the source file, its material files (the texture references come from them) and the import flags
+    // haven't changed.
     void loadModel(string const &path)
     {
+        const unsigned int importFlags = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+        auto start = std::chrono::steady_clock::now();
+
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+
+        // try the cooked file first
+        const string cookedPath = path + ".cooked";
+        const uint64_t sourceHash = HashModelSources(path);
+        if (sourceHash != 0 && loadCookedModel(cookedPath, sourceHash, importFlags))
+        {
+            cout << "Model: " << path << " loaded from cooked file in " << ElapsedMs(start) << " ms" << endl;
+            reportVertexMemory();
+            return;
+        }
+
         // read file via ASSIMP
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene = importer.ReadFile(path, importFlags);
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
             return;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        // process ASSIMP's root node recursively, then convert the meshes it references
+        vector<aiMesh*> order;
+        processNode(scene->mRootNode, scene, order);
+        vector<MeshData> data = processMeshes(order, scene);
+
+        // cook before the data is moved into the meshes
+        if (sourceHash != 0 && !WriteCookedMeshes(cookedPath, sourceHash, importFlags, data))
+            cout << "WARNING::MODEL:: failed to write cooked file " << cookedPath << endl;
+
+        uploadMeshes(data);
+        cout << "Model: " << path << " loaded via assimp in " << ElapsedMs(start) << " ms" << endl;
+        reportVertexMemory();
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    // prints the vertex buffer memory of the model and what the float layout would have needed
+    void reportVertexMemory()
     {
-        // process each mesh located at the current node
+        size_t bytes = 0, floatBytes = 0;
+        for(const Mesh &mesh : meshes)
+        {
+            bytes += mesh.vertexBytes;
+            floatBytes += mesh.vertexBytes / (mesh.format == VERTEX_PACKED ? sizeof(PackedVertex) : sizeof(Vertex)) * sizeof(Vertex);
+        }
+        cout << "Model: vertex buffers " << bytes / 1024 << " KB";
+        if(vertexFormat == VERTEX_PACKED)
+            cout << " (" << (floatBytes - bytes) / 1024 << " KB saved by packing)";
+        cout << endl;
+    }
+
+    // maps a cooked file and creates the meshes straight from the mapped bytes. Returns false if there is no valid cooked file.
+    bool loadCookedModel(const string &cookedPath, uint64_t sourceHash, unsigned int importFlags)
+    {
+        MappedFile file(cookedPath);
+        vector<CookedMeshView> views;
+        if (!file.valid() || !ReadCookedMeshes(file, sourceHash, importFlags, views))
+            return false;
+
+        meshes.reserve(meshes.size() + views.size());
+        for (const CookedMeshView &view : views)
+            meshes.push_back(Mesh(view.vertices, view.vertexCount, view.indices, view.indexCount, loadMaterialTextures(view.textures), vertexFormat));
+        return true;
+    }
+
+    // processes a node in a recursive fashion. Collects each individual mesh located at the node and repeats this process on its children nodes (if any).
+    // the resulting order is the same depth-first order the meshes used to be created in.
+    void processNode(aiNode *node, const aiScene *scene, vector<aiMesh*> &order)
+    {
+        // collect each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            order.push_back(scene->mMeshes[node->mMeshes[i]]);
         }
-        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
+        // after we've collected all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, order);
         }
+    }
 
+    // converts the collected meshes in parallel. Every task only reads the (immutable) scene and writes its own slot,
+    // so no locking is needed and the output order matches the input order. GL objects are created afterwards, 
+    // on the calling thread which owns the context.
+    vector<MeshData> processMeshes(const vector<aiMesh*> &order, const aiScene *scene)
+    {
+        vector<MeshData> data(order.size());
+        std::atomic<size_t> next(0);
+        auto worker = [&]()
+        {
+            for(size_t i = next++; i < order.size(); i = next++)
+                data[i] = processMesh(order[i], scene);
+        };
+
+        size_t threadCount = (std::min)((size_t)(std::max)(1u, std::thread::hardware_concurrency()), order.size());
+        vector<std::thread> threads;
+        for(size_t i = 1; i < threadCount; i++)
+            threads.emplace_back(worker);
+        worker(); // the calling thread takes part as well
+        for(std::thread &t : threads)
+            t.join();
+        return data;
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // single upload phase: load the textures and create the buffers in mesh order
+    void uploadMeshes(vector<MeshData> &data)
+    {
+        meshes.reserve(meshes.size() + data.size());
+        for(MeshData &d : data)
+            meshes.push_back(Mesh(std::move(d.vertices), std::move(d.indices), loadMaterialTextures(d.textures), vertexFormat));
+    }
+
+    MeshData processMesh(aiMesh *mesh, const aiScene *scene)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        MeshData data;
+        vector<Vertex> &vertices = data.vertices;
+        vector<unsigned int> &indices = data.indices;
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
 
         // Walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -150,58 +270,75 @@ private:
         // normal: texture_normalN
 
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        collectMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", data.textures);
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        collectMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", data.textures);
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+        collectMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", data.textures);
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+        collectMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", data.textures);
         
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // return the extracted mesh data, the GL mesh is created later on the context thread
+        return data;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // gathers the texture paths of a given type from a material. Only reads the material, safe to call from worker threads.
+    void collectMaterialTextures(aiMaterial *mat, aiTextureType type, const string &typeName, vector<TextureRef> &out)
     {
-        vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            out.push_back({ typeName, str.C_Str() });
+        }
+    }
+
+    // loads the textures referenced by a mesh if they're not loaded yet.
+    // the required info is returned as a Texture struct.
+    vector<Texture> loadMaterialTextures(const vector<TextureRef> &refs)
+    {
+        vector<Texture> textures;
+        for(const TextureRef &ref : refs)
+        {
+            // check if this model already holds the texture, otherwise take a reference from the process-wide registry
+            // (which only loads the file if no other model has it either).
+            auto it = textureIndex.find(ref.path);
+            if(it != textureIndex.end())
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+                Texture texture = textures_loaded[it->second].share();
+                texture.type = ref.type;
+                textures.push_back(std::move(texture));
+                continue;
             }
+            Texture texture;
+            texture.id = TextureRegistry::instance().acquire(this->directory + '/' + ref.path, gammaCorrection, GL_REPEAT, streamTextures, mipFlags(ref));
+            texture.type = ref.type;
+            texture.path = ref.path;
+            textures.push_back(texture.share());
+            textureIndex[ref.path] = textures_loaded.size();
+            textures_loaded.push_back(std::move(texture));  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
         }
         return textures;
     }
+
+    // how the mip chain of a texture is filtered, from the sampler it's bound to and its file name
+    static int mipFlags(const TextureRef &ref)
+    {
+        if(ref.type == "texture_normal")
+            return MIPMAP_NORMAL_MAP;
+        int flags = ref.type == "texture_diffuse" ? MIPMAP_SRGB : 0;
+        // alpha tested cutouts, such as nanosuit's cell_*_alpha.png
+        if(ref.path.find("_alpha") != string::npos)
+            flags |= MIPMAP_ALPHA_COVERAGE;
+        return flags;
+    }
+
+    // path -> index into textures_loaded
+    unordered_map<string, size_t> textureIndex;
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma, int mipFlags)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
@@ -209,33 +346,21 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    // the mip chain is filtered on the CPU once and cached to '<file>.mips', see mip_cache.h
+    MipChain chain;
+    if (chain.load(filename, mipFlags))
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        chain.upload();
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
     }
     else
     {
         std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
     }
 
     return textureID;
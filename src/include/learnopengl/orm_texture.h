@@ -0,0 +1,301 @@
+#ifndef ORM_TEXTURE_H
+#define ORM_TEXTURE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/file_cache.h>
+
+#include <stb_image.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+// Ambient occlusion, roughness and metallic of a PBR material packed into one RGB8 texture in the glTF order
+// (R = occlusion, G = roughness, B = metallic), so the shader binds one sampler and does one fetch instead of three.
+//
+// The maps are read from '<material>/ao.png', 'roughness.png' and 'metallic.png', the first channel of each. A missing
+// map becomes a constant (ao 1, roughness 1, metallic 0) and maps of different sizes are resampled (nearest) to the
+// largest one. The mip chain is box filtered on the CPU, the data is linear so no gamma handling is needed. Packed
+// texels are cached to '<material>/orm.cache' and reused as long as the three source files are unchanged.
+//
+// cache layout:
+//   OrmCacheHeader
+//   per level, width >> level by height >> level (at least 1) RGB8 texels, rows tightly packed
+const CacheTag ORM_CACHE_TAG = { { 'G', 'L', 'O', 'R' }, 1 };
+
+struct OrmCacheHeader {
+    CacheTag tag;
+    uint64_t sourceHash;    // hash of the three source files
+    uint32_t width;
+    uint32_t height;
+    uint32_t levels;
+    uint32_t reserved;
+};
+
+class OrmTexture
+{
+public:
+    unsigned int texture = 0;
+    int width = 0, height = 0, levels = 0;
+
+    OrmTexture() {}
+
+    OrmTexture(const OrmTexture &) = delete;
+    OrmTexture &operator=(const OrmTexture &) = delete;
+
+    // loads (or packs and caches) the ORM texture of a material folder. Returns false if none of the maps exist, the
+    // texture then holds the constants and shaders keep working.
+    bool load(const std::string &materialDir)
+    {
+        release();
+        std::vector<unsigned char> cache;
+        bool found = Cook(materialDir, cache);
+        const OrmCacheHeader *header = (const OrmCacheHeader *)cache.data();
+        width = (int)header->width;
+        height = (int)header->height;
+        levels = (int)header->levels;
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        const unsigned char *texels = cache.data() + sizeof(OrmCacheHeader);
+        for (int level = 0; level < levels; level++)
+        {
+            int w = levelSize(width, level), h = levelSize(height, level);
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGB8, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, texels);
+            texels += (size_t)w * h * 3;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return found;
+    }
+
+    // binds the texture to unit and points the sampler uniform ormMap of the current program at it
+    void bind(GLuint program, int unit)
+    {
+        if (program != boundProgram)
+        {
+            location = glGetUniformLocation(program, "ormMap");
+            boundProgram = program;
+        }
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glUniform1i(location, unit);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void release()
+    {
+        if (texture)
+            glDeleteTextures(1, &texture);
+        texture = 0;
+        width = height = levels = 0;
+        boundProgram = 0;
+    }
+
+    // Fills cache with the packed mip chain of a material (header included), from '<material>/orm.cache' when it is
+    // up to date, otherwise packed from the maps and written back. Needs no GL context. Returns false if none of the
+    // maps exist.
+    static bool Cook(const std::string &materialDir, std::vector<unsigned char> &cache)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<unsigned char> files[3];
+        uint64_t sourceHash = 14695981039346656037ull;
+        bool found = false;
+        for (int i = 0; i < 3; i++)
+        {
+            found |= ReadFileBytes(mapPath(materialDir, i), files[i]);
+            // the size goes into the hash too, so a map going missing changes it
+            sourceHash = HashBytes(files[i].data(), files[i].size(), sourceHash ^ files[i].size());
+        }
+
+        const std::string cachePath = materialDir + "/orm.cache";
+        if (ReadFileBytes(cachePath, cache) && validCache(cache, sourceHash))
+        {
+            std::cout << "ORM: " << materialDir << " loaded from cache in " << ElapsedMs(start) << " ms" << std::endl;
+            return found;
+        }
+
+        int w, h;
+        std::vector<unsigned char> packed;
+        Pack(files, packed, w, h);
+        buildCache(packed, w, h, sourceHash, cache);
+        if (!found)
+        {
+            std::cout << "ERROR::ORM::no ao/roughness/metallic maps in " << materialDir << ", using constants" << std::endl;
+            return false;
+        }
+
+        if (!WriteCacheFile(cachePath, cache))
+            std::cout << "WARNING::ORM:: failed to write cache " << cachePath << std::endl;
+        std::cout << "ORM: " << materialDir << " packed " << w << "x" << h << " in " << ElapsedMs(start) << " ms" << std::endl;
+        return true;
+    }
+
+    // Compares level 0 of the cached texture with the source maps decoded on their own, texel by texel. Returns the
+    // number of differing texels, or -1 if the cache is missing or stale.
+    static long long Verify(const std::string &materialDir)
+    {
+        std::vector<unsigned char> files[3], cache;
+        uint64_t sourceHash = 14695981039346656037ull;
+        for (int i = 0; i < 3; i++)
+        {
+            ReadFileBytes(mapPath(materialDir, i), files[i]);
+            sourceHash = HashBytes(files[i].data(), files[i].size(), sourceHash ^ files[i].size());
+        }
+        if (!ReadFileBytes(materialDir + "/orm.cache", cache) || !validCache(cache, sourceHash))
+            return -1;
+        const OrmCacheHeader *header = (const OrmCacheHeader *)cache.data();
+        int w = (int)header->width, h = (int)header->height;
+        const unsigned char *texels = cache.data() + sizeof(OrmCacheHeader);
+
+        long long mismatches = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            int mw = 1, mh = 1, channels = 1;
+            unsigned char *map = files[i].empty() ? nullptr :
+                stbi_load_from_memory(files[i].data(), (int)files[i].size(), &mw, &mh, &channels, 0);
+            for (int y = 0; y < h; y++)
+                for (int x = 0; x < w; x++)
+                {
+                    // the texel of the source map that covers this one
+                    int sx = (int)((long long)x * mw / w), sy = (int)((long long)y * mh / h);
+                    unsigned char expected = map ? map[((size_t)sy * mw + sx) * channels] : MAP_DEFAULTS[i];
+                    if (texels[((size_t)y * w + x) * 3 + i] != expected)
+                        mismatches++;
+                }
+            if (map)
+                stbi_image_free(map);
+        }
+        return mismatches;
+    }
+
+private:
+    // channel order of the packed texture
+    static constexpr const char *MAP_NAMES[3] = { "ao", "roughness", "metallic" };
+    static constexpr unsigned char MAP_DEFAULTS[3] = { 255, 255, 0 };
+
+    GLuint boundProgram = 0;
+    GLint location = -1;
+
+    static std::string mapPath(const std::string &materialDir, int map)
+    {
+        return materialDir + "/" + MAP_NAMES[map] + ".png";
+    }
+
+    static int levelSize(int size, int level)
+    {
+        return (std::max)(size >> level, 1);
+    }
+
+    static size_t cacheSize(int w, int h, int levels)
+    {
+        size_t bytes = sizeof(OrmCacheHeader);
+        for (int level = 0; level < levels; level++)
+            bytes += (size_t)levelSize(w, level) * levelSize(h, level) * 3;
+        return bytes;
+    }
+
+    static bool validCache(const std::vector<unsigned char> &cache, uint64_t sourceHash)
+    {
+        if (cache.size() < sizeof(OrmCacheHeader))
+            return false;
+        const OrmCacheHeader *header = (const OrmCacheHeader *)cache.data();
+        return header->tag == ORM_CACHE_TAG && header->sourceHash == sourceHash &&
+            header->width > 0 && header->height > 0 && header->levels > 0 && header->levels <= 32 &&
+            cache.size() == cacheSize((int)header->width, (int)header->height, (int)header->levels);
+    }
+
+    // decodes the three maps and interleaves their first channels at the size of the largest one
+    static void Pack(const std::vector<unsigned char> files[3], std::vector<unsigned char> &packed, int &w, int &h)
+    {
+        unsigned char *maps[3];
+        int sizes[3][3];
+        w = h = 1;
+        for (int i = 0; i < 3; i++)
+        {
+            maps[i] = files[i].empty() ? nullptr :
+                stbi_load_from_memory(files[i].data(), (int)files[i].size(), &sizes[i][0], &sizes[i][1], &sizes[i][2], 0);
+            if (!maps[i])
+            {
+                sizes[i][0] = sizes[i][1] = 1;
+                continue;
+            }
+            if ((long long)sizes[i][0] * sizes[i][1] > (long long)w * h)
+            {
+                w = sizes[i][0];
+                h = sizes[i][1];
+            }
+        }
+
+        packed.resize((size_t)w * h * 3);
+        for (int i = 0; i < 3; i++)
+        {
+            int mw = sizes[i][0], mh = sizes[i][1], channels = maps[i] ? sizes[i][2] : 1;
+            for (int y = 0; y < h; y++)
+            {
+                int sy = (int)((long long)y * mh / h);
+                for (int x = 0; x < w; x++)
+                {
+                    int sx = (int)((long long)x * mw / w);
+                    packed[((size_t)y * w + x) * 3 + i] = maps[i] ? maps[i][((size_t)sy * mw + sx) * channels] : MAP_DEFAULTS[i];
+                }
+            }
+            if (maps[i])
+                stbi_image_free(maps[i]);
+        }
+    }
+
+    // header plus the full mip chain, every level a 2x2 box filter of the previous one (edge texels repeated for odd sizes)
+    static void buildCache(const std::vector<unsigned char> &packed, int w, int h, uint64_t sourceHash, std::vector<unsigned char> &cache)
+    {
+        int levelCount = 1;
+        while ((w >> levelCount) > 0 || (h >> levelCount) > 0)
+            levelCount++;
+        cache.assign(cacheSize(w, h, levelCount), 0);
+
+        OrmCacheHeader *header = (OrmCacheHeader *)cache.data();
+        header->tag = ORM_CACHE_TAG;
+        header->sourceHash = sourceHash;
+        header->width = (uint32_t)w;
+        header->height = (uint32_t)h;
+        header->levels = (uint32_t)levelCount;
+
+        unsigned char *level = cache.data() + sizeof(OrmCacheHeader);
+        std::memcpy(level, packed.data(), packed.size());
+        for (int l = 1; l < levelCount; l++)
+        {
+            int pw = levelSize(w, l - 1), ph = levelSize(h, l - 1);
+            int lw = levelSize(w, l), lh = levelSize(h, l);
+            const unsigned char *previous = level;
+            level += (size_t)pw * ph * 3;
+            for (int y = 0; y < lh; y++)
+            {
+                int y0 = (std::min)(y * 2, ph - 1), y1 = (std::min)(y * 2 + 1, ph - 1);
+                for (int x = 0; x < lw; x++)
+                {
+                    int x0 = (std::min)(x * 2, pw - 1), x1 = (std::min)(x * 2 + 1, pw - 1);
+                    for (int c = 0; c < 3; c++)
+                    {
+                        int sum = previous[((size_t)y0 * pw + x0) * 3 + c] + previous[((size_t)y0 * pw + x1) * 3 + c] +
+                            previous[((size_t)y1 * pw + x0) * 3 + c] + previous[((size_t)y1 * pw + x1) * 3 + c];
+                        level[((size_t)y * lw + x) * 3 + c] = (unsigned char)((sum + 2) >> 2);
+                    }
+                }
+            }
+        }
+    }
+};
+
+constexpr const char *OrmTexture::MAP_NAMES[3];
+constexpr unsigned char OrmTexture::MAP_DEFAULTS[3];
+#endif
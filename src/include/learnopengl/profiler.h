@@ -0,0 +1,335 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <unordered_map>
+
+// Frame profiler for nested CPU/GPU scopes.
+// Every scope records its CPU time and brackets its GL commands with two GL_TIMESTAMP queries. Results are read back
+// FRAME_LATENCY frames later and only if they are already available, so the profiler never waits for the GPU; frames
+// whose queries are still in flight by then are dropped. When GL 4.3 is available every scope is also pushed as a
+// debug group, so captures in RenderDoc/Nsight show the same names.
+//
+//   profiler.beginFrame();
+//   { ProfileScope scope(profiler, "bloom"); ... }
+//   profiler.endFrame();
+//
+// Scope names must be string literals (or otherwise outlive the profiler). Use on the GL context thread only and
+// call release() before the context is destroyed.
+class Profiler
+{
+public:
+    static const int FRAME_LATENCY = 3;
+
+    Profiler()
+    {
+        epoch = std::chrono::steady_clock::now();
+    }
+
+    ~Profiler()
+    {
+        stopTrace();
+    }
+
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    void beginFrame()
+    {
+        if (!initialized)
+        {
+            initialized = true;
+            debugGroups = GLAD_GL_VERSION_4_3 != 0;
+        }
+
+        // the slot we're about to reuse was recorded FRAME_LATENCY frames ago
+        Frame &frame = frames[frameIndex % FRAME_LATENCY];
+        if (frame.recorded)
+            resolve(frame);
+
+        frame.index = frameIndex;
+        frame.samples.clear();
+        frame.usedQueries = 0;
+        frame.lastQuery = 0;
+        frame.recorded = false;
+        depth = 0;
+        inFrame = true;
+    }
+
+    void endFrame()
+    {
+        if (!inFrame)
+            return;
+        Frame &frame = frames[frameIndex % FRAME_LATENCY];
+        frame.recorded = true;
+        inFrame = false;
+        frameIndex++;
+    }
+
+    // opens a scope, returns its handle for end(). Prefer ProfileScope.
+    int begin(const char *name)
+    {
+        if (!inFrame)
+            return -1;
+        Frame &frame = frames[frameIndex % FRAME_LATENCY];
+        Sample sample;
+        sample.name = name;
+        sample.depth = depth++;
+        sample.cpuBegin = nowMicroseconds();
+        sample.queryBegin = nextQuery(frame);
+        sample.queryEnd = nextQuery(frame);
+        glQueryCounter(sample.queryBegin, GL_TIMESTAMP);
+        frame.lastQuery = sample.queryBegin;
+        if (debugGroups)
+            glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+        frame.samples.push_back(sample);
+        return (int)frame.samples.size() - 1;
+    }
+
+    void end(int handle)
+    {
+        if (!inFrame || handle < 0)
+            return;
+        Frame &frame = frames[frameIndex % FRAME_LATENCY];
+        Sample &sample = frame.samples[handle];
+        if (debugGroups)
+            glPopDebugGroup();
+        glQueryCounter(sample.queryEnd, GL_TIMESTAMP);
+        frame.lastQuery = sample.queryEnd;
+        sample.cpuEnd = nowMicroseconds();
+        depth--;
+    }
+
+    // writes the frames recorded from now on as Chrome trace events (chrome://tracing, ui.perfetto.dev) until
+    // stopTrace() or, if maxFrames isn't 0, until maxFrames of them have been resolved. Frames are written when they
+    // resolve, FRAME_LATENCY frames after they were recorded.
+    bool startTrace(const std::string &path, unsigned int maxFrames = 0)
+    {
+        stopTrace();
+        trace.open(path, std::ios::trunc);
+        if (!trace)
+        {
+            std::cout << "ERROR::PROFILER::can't write " << path << std::endl;
+            return false;
+        }
+        trace << "{\"traceEvents\":[\n";
+        traceEvents = 0;
+        // a frame already in progress started before the trace
+        traceFirstFrame = frameIndex + (inFrame ? 1 : 0);
+        traceLastFrame = maxFrames ? traceFirstFrame + maxFrames - 1 : ~0ull;
+
+        // offset between the GL clock and ours, so GPU events line up with the CPU ones
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        gpuToCpuMicroseconds = nowMicroseconds() - gpuNow / 1000.0;
+        writeThreadName(0, "CPU");
+        writeThreadName(1, "GPU");
+        return true;
+    }
+
+    void stopTrace()
+    {
+        if (!trace.is_open())
+            return;
+        trace << "\n]}\n";
+        trace.close();
+    }
+
+    bool tracing() const { return trace.is_open(); }
+
+    // average CPU/GPU milliseconds of every scope since the last report(), indented by nesting depth
+    void report(std::ostream &out = std::cout)
+    {
+        out << std::fixed << std::setprecision(3);
+        out << "scope                         cpu ms    gpu ms" << std::endl;
+        for (const std::string &name : order)
+        {
+            Stat &stat = stats[name];
+            if (stat.count == 0)
+                continue;
+            std::string label = std::string(stat.depth * 2, ' ') + name;
+            out << std::left << std::setw(28) << label << std::right
+                << std::setw(9) << stat.cpuMs / stat.count
+                << std::setw(10) << (stat.gpuCount ? stat.gpuMs / stat.gpuCount : 0.0) << std::endl;
+            stat = Stat{ 0.0, 0.0, 0, 0, stat.depth };
+        }
+        if (droppedFrames)
+            out << "(" << droppedFrames << " frames dropped, GPU results not ready in time)" << std::endl;
+        droppedFrames = 0;
+        out << std::defaultfloat;
+    }
+
+    // latest resolved GPU time of a scope in milliseconds, 0 if unknown
+    double lastGpuMs(const std::string &name) const
+    {
+        auto it = lastGpu.find(name);
+        return it != lastGpu.end() ? it->second : 0.0;
+    }
+
+    // deletes the queries, call before the GL context goes away
+    void release()
+    {
+        for (Frame &frame : frames)
+        {
+            if (!frame.queries.empty())
+                glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+            frame.queries.clear();
+            frame.samples.clear();
+            frame.recorded = false;
+        }
+    }
+
+private:
+    struct Sample {
+        const char *name;
+        int depth;
+        double cpuBegin, cpuEnd;    // microseconds since the profiler was created
+        GLuint queryBegin, queryEnd;
+    };
+
+    struct Frame {
+        std::vector<Sample> samples;
+        std::vector<GLuint> queries;
+        size_t usedQueries = 0;
+        unsigned long long index = 0;
+        GLuint lastQuery = 0;       // the query issued last, it completes after all the others
+        bool recorded = false;
+    };
+
+    struct Stat {
+        double cpuMs, gpuMs;
+        unsigned int count, gpuCount;
+        int depth;
+    };
+
+    Frame frames[FRAME_LATENCY];
+    unsigned long long frameIndex = 0;
+    int depth = 0;
+    bool inFrame = false;
+    bool initialized = false;
+    bool debugGroups = false;
+    std::chrono::steady_clock::time_point epoch;
+
+    std::unordered_map<std::string, Stat> stats;
+    std::unordered_map<std::string, double> lastGpu;
+    std::vector<std::string> order;
+    unsigned int droppedFrames = 0;
+
+    std::ofstream trace;
+    size_t traceEvents = 0;
+    unsigned long long traceFirstFrame = 0, traceLastFrame = 0;
+    double gpuToCpuMicroseconds = 0.0;
+
+    double nowMicroseconds() const
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    GLuint nextQuery(Frame &frame)
+    {
+        if (frame.usedQueries == frame.queries.size())
+        {
+            size_t grow = frame.queries.empty() ? 16 : frame.queries.size();
+            frame.queries.resize(frame.queries.size() + grow);
+            glGenQueries((GLsizei)grow, &frame.queries[frame.usedQueries]);
+        }
+        return frame.queries[frame.usedQueries++];
+    }
+
+    // collects the results of a recorded frame, unless the GPU hasn't finished it yet
+    void resolve(Frame &frame)
+    {
+        frame.recorded = false;
+        bool traced = trace.is_open() && frame.index >= traceFirstFrame && frame.index <= traceLastFrame;
+        if (frame.samples.empty() || frame.lastQuery == 0)
+        {
+            if (traced && frame.index == traceLastFrame)
+                stopTrace();
+            return;
+        }
+
+        // queries complete in the order they were issued, so the one issued last tells whether the whole frame is
+        // done. That isn't the last sample's end: an enclosing scope ends after its children.
+        GLint available = 0;
+        glGetQueryObjectiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        bool gpu = available != 0;
+        if (!gpu)
+            droppedFrames++;
+
+        for (const Sample &sample : frame.samples)
+        {
+            double gpuBegin = 0.0, gpuEnd = 0.0;
+            if (gpu)
+            {
+                GLuint64 begin = 0, end = 0;
+                glGetQueryObjectui64v(sample.queryBegin, GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(sample.queryEnd, GL_QUERY_RESULT, &end);
+                gpuBegin = begin / 1000.0;
+                gpuEnd = end / 1000.0;
+            }
+
+            auto it = stats.find(sample.name);
+            if (it == stats.end())
+            {
+                order.push_back(sample.name);
+                it = stats.emplace(sample.name, Stat{ 0.0, 0.0, 0, 0, sample.depth }).first;
+            }
+            Stat &stat = it->second;
+            stat.cpuMs += (sample.cpuEnd - sample.cpuBegin) / 1000.0;
+            stat.count++;
+            if (gpu)
+            {
+                stat.gpuMs += (gpuEnd - gpuBegin) / 1000.0;
+                stat.gpuCount++;
+                lastGpu[sample.name] = (gpuEnd - gpuBegin) / 1000.0;
+            }
+
+            if (traced)
+            {
+                writeEvent(sample.name, 0, sample.cpuBegin, sample.cpuEnd - sample.cpuBegin, frame.index);
+                if (gpu)
+                    writeEvent(sample.name, 1, gpuBegin + gpuToCpuMicroseconds, gpuEnd - gpuBegin, frame.index);
+            }
+        }
+        if (traced && frame.index == traceLastFrame)
+            stopTrace();
+    }
+
+    void writeEvent(const char *name, int thread, double start, double duration, unsigned long long frame)
+    {
+        trace << (traceEvents++ ? ",\n" : "") << std::fixed << std::setprecision(3)
+              << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread
+              << ",\"ts\":" << start << ",\"dur\":" << duration
+              << ",\"args\":{\"frame\":" << frame << "}}";
+    }
+
+    void writeThreadName(int thread, const char *name)
+    {
+        trace << (traceEvents++ ? ",\n" : "")
+              << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread
+              << ",\"args\":{\"name\":\"" << name << "\"}}";
+    }
+};
+
+// RAII profiling scope
+class ProfileScope
+{
+public:
+    ProfileScope(Profiler &profiler, const char *name) : profiler(profiler), handle(profiler.begin(name)) {}
+    ~ProfileScope() { profiler.end(handle); }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    Profiler &profiler;
+    int handle;
+};
+#endif
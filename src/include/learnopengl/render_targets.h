@@ -0,0 +1,258 @@
+#ifndef RENDER_TARGETS_H
+#define RENDER_TARGETS_H
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+// a single colour texture (plus optional depth renderbuffer) with its framebuffer
+struct RenderTarget {
+    unsigned int fbo = 0;
+    unsigned int texture = 0;
+    unsigned int depth = 0;
+    int width = 0, height = 0;
+    GLenum format = GL_NONE;
+};
+
+// Pool of offscreen render targets that follows the window size. The output size comes from the framebuffer size
+// callback, the internal render size is output size * render scale. Both may change at any time; the pool only
+// reacts in beginFrame(), dropping every target of the old size, so attachments are rebuilt lazily on first use.
+//
+// Passes acquire() targets when they start writing them and release() them once the last pass has read them, a
+// released target is handed to the next acquire() with the same size/format in the same frame (aliasing). Targets
+// that stayed unused for a few frames are deleted, which keeps the memory of the post-processing chain bounded.
+// All calls must be made on the GL context thread, clear() before the context is destroyed.
+class RenderTargetPool
+{
+public:
+    // frames a released target is kept around before it's deleted
+    unsigned int maxIdleFrames = 3;
+
+    RenderTargetPool(int width = 1, int height = 1, float scale = 1.0f)
+    {
+        resize(width, height);
+        setRenderScale(scale);
+    }
+
+    ~RenderTargetPool()
+    {
+        if (!entries.empty())
+            std::cout << "WARNING::RENDER_TARGETS::" << entries.size() << " targets leaked, call clear() before destroying the context" << std::endl;
+    }
+
+    RenderTargetPool(const RenderTargetPool &) = delete;
+    RenderTargetPool &operator=(const RenderTargetPool &) = delete;
+
+    // size of the window's framebuffer, zero sizes (minimized window) are ignored
+    void resize(int width, int height)
+    {
+        if (width > 0 && height > 0)
+        {
+            pendingOutputWidth = width;
+            pendingOutputHeight = height;
+        }
+    }
+
+    // fraction of the output resolution the scene is rendered at
+    void setRenderScale(float scale)
+    {
+        pendingScale = (std::max)(scale, 0.01f);
+    }
+
+    // applies pending size/scale changes. Returns true if the render size changed (all targets were dropped).
+    bool beginFrame()
+    {
+        frame++;
+        outputW = pendingOutputWidth;
+        outputH = pendingOutputHeight;
+        scale = pendingScale;
+        int width = (std::max)(1, (int)std::lround(outputW * scale));
+        int height = (std::max)(1, (int)std::lround(outputH * scale));
+        if (width == renderW && height == renderH)
+            return false;
+
+        renderW = width;
+        renderH = height;
+        clear();
+        return true;
+    }
+
+    // deletes targets that stayed unused for maxIdleFrames and warns about targets that were never released
+    void endFrame()
+    {
+        for (size_t i = 0; i < entries.size();)
+        {
+            Entry &entry = entries[i];
+            if (entry.inUse)
+            {
+                std::cout << "WARNING::RENDER_TARGETS::target " << entry.target.width << "x" << entry.target.height << " not released this frame" << std::endl;
+                entry.inUse = false;
+                entry.lastUsed = frame;
+            }
+            if (!entry.inUse && frame - entry.lastUsed > maxIdleFrames)
+            {
+                destroy(entry);
+                entries[i] = entries.back();
+                entries.pop_back();
+            }
+            else
+                i++;
+        }
+    }
+
+    // returns a free target of the given size/format, creating it if none is pooled
+    RenderTarget acquire(int width, int height, GLenum format, bool depth = false)
+    {
+        width = (std::max)(width, 1);
+        height = (std::max)(height, 1);
+        for (Entry &entry : entries)
+        {
+            if (!entry.inUse && entry.target.width == width && entry.target.height == height &&
+                entry.target.format == format && (entry.target.depth != 0) == depth)
+            {
+                entry.inUse = true;
+                entry.lastUsed = frame;
+                return entry.target;
+            }
+        }
+
+        Entry entry;
+        entry.target = create(width, height, format, depth);
+        entry.bytes = (size_t)width * height * (bytesPerPixel(format) + (depth ? 4 : 0));
+        entry.inUse = true;
+        entry.lastUsed = frame;
+        entries.push_back(entry);
+
+        allocated += entry.bytes;
+        peak = (std::max)(peak, allocated);
+        return entry.target;
+    }
+
+    // target at the current render size
+    RenderTarget acquireScaled(GLenum format, bool depth = false)
+    {
+        return acquire(renderW, renderH, format, depth);
+    }
+
+    // hands the target back to the pool, later passes may reuse its memory
+    void release(const RenderTarget &target)
+    {
+        Entry *entry = find(target.fbo);
+        if (!entry)
+            return;
+        entry->inUse = false;
+        entry->lastUsed = frame;
+    }
+
+    // deletes every target, in use or not
+    void clear()
+    {
+        for (Entry &entry : entries)
+            destroy(entry);
+        entries.clear();
+    }
+
+    int renderWidth() const { return renderW; }
+    int renderHeight() const { return renderH; }
+    int outputWidth() const { return outputW; }
+    int outputHeight() const { return outputH; }
+    float renderScale() const { return scale; }
+
+    // estimated video memory of all pooled targets, current and high water mark
+    size_t allocatedBytes() const { return allocated; }
+    size_t peakBytes() const { return peak; }
+    size_t targetCount() const { return entries.size(); }
+
+    void report(std::ostream &out = std::cout) const
+    {
+        out << "render " << renderW << "x" << renderH << " (scale " << scale << ") targets: " << entries.size()
+            << " memory: " << allocated / (1024.0 * 1024.0) << " MB peak: " << peak / (1024.0 * 1024.0) << " MB" << std::endl;
+    }
+
+    static size_t bytesPerPixel(GLenum format)
+    {
+        switch (format)
+        {
+        case GL_R8: return 1;
+        case GL_RG8: case GL_R16F: return 2;
+        case GL_RGB16F: return 6;
+        case GL_RGBA16F: case GL_RG32F: return 8;
+        case GL_RGB32F: return 12;
+        case GL_RGBA32F: return 16;
+        default: return 4; // GL_RGBA8, GL_R11F_G11F_B10F, GL_RGB10_A2, GL_R32F ...
+        }
+    }
+
+private:
+    struct Entry {
+        RenderTarget target;
+        size_t bytes = 0;
+        unsigned long long lastUsed = 0;
+        bool inUse = false;
+    };
+
+    std::vector<Entry> entries;
+    int pendingOutputWidth = 1, pendingOutputHeight = 1;
+    float pendingScale = 1.0f;
+    int outputW = 0, outputH = 0;
+    int renderW = 0, renderH = 0;
+    float scale = 1.0f;
+    unsigned long long frame = 0;
+    size_t allocated = 0;
+    size_t peak = 0;
+
+    Entry *find(unsigned int fbo)
+    {
+        for (Entry &entry : entries)
+            if (entry.target.fbo == fbo)
+                return &entry;
+        return nullptr;
+    }
+
+    void destroy(Entry &entry)
+    {
+        glDeleteFramebuffers(1, &entry.target.fbo);
+        glDeleteTextures(1, &entry.target.texture);
+        if (entry.target.depth)
+            glDeleteRenderbuffers(1, &entry.target.depth);
+        allocated -= entry.bytes;
+    }
+
+    static RenderTarget create(int width, int height, GLenum format, bool depth)
+    {
+        RenderTarget target;
+        target.width = width;
+        target.height = height;
+        target.format = format;
+
+        glGenFramebuffers(1, &target.fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+
+        // the pixel format of the (empty) upload doesn't matter, only the internal format does
+        glGenTextures(1, &target.texture);
+        glBindTexture(GL_TEXTURE_2D, target.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+
+        if (depth)
+        {
+            glGenRenderbuffers(1, &target.depth);
+            glBindRenderbuffer(GL_RENDERBUFFER, target.depth);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target.depth);
+        }
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::RENDER_TARGETS::Framebuffer not complete! " << width << "x" << height << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return target;
+    }
+};
+#endif
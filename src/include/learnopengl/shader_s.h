@@ -8,10 +8,13 @@
 #include <sstream>
 #include <iostream>
 
+#include <learnopengl/uniform_cache.h>
+
 class Shader
 {
 public:
     unsigned int ID;
+    UniformCache uniforms;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath)
@@ -64,31 +67,62 @@ public:
         glAttachShader(ID, fragment);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        // look up every active uniform once, the setters below only index this table
+        uniforms.build(ID);
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
     }
+    // the program is owned by the shader: move-only, deleted in the destructor
+    // ------------------------------------------------------------------------
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+    Shader(Shader &&other) noexcept : ID(other.ID), uniforms(std::move(other.uniforms))
+    {
+        other.ID = 0;
+    }
+    Shader &operator=(Shader &&other) noexcept
+    {
+        if (this != &other)
+        {
+            glDeleteProgram(ID);
+            ID = other.ID;
+            uniforms = std::move(other.uniforms);
+            other.ID = 0;
+        }
+        return *this;
+    }
+    ~Shader()
+    {
+        glDeleteProgram(ID); // 0 is silently ignored
+    }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
         glUseProgram(ID); 
     }
+    // location of an active uniform, -1 if there is none with that name
+    // ------------------------------------------------------------------------
+    GLint location(UniformName name) const
+    {
+        return uniforms[name];
+    }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(UniformName name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(uniforms[name], (int)value); 
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(UniformName name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(uniforms[name], value); 
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(UniformName name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(uniforms[name], value); 
     }
 
 private:
@@ -0,0 +1,154 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/texture_streamer.h>
+
+#include <image_helper.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cctype>
+
+unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma, int mipFlags);
+
+// Process-wide, reference counted texture cache. Textures are keyed by their canonical path plus the sampling
+// parameters they were created with, so every model asking for the same file shares one GL texture.
+// The texture is deleted as soon as the last reference is released. Must be used on the GL context thread.
+class TextureRegistry
+{
+public:
+    static TextureRegistry &instance()
+    {
+        static TextureRegistry registry;
+        return registry;
+    }
+
+    // returns the texture for the given file, loading it on a miss. Every call must be paired with a release().
+    // mipFlags are the MIPMAP_* flags (image_helper.h) its mip chain is filtered with, MIPMAP_WRAP follows wrap.
+    // Streamed textures still get their mips from glGenerateMipmap.
+    unsigned int acquire(const std::string &path, bool gamma = false, GLint wrap = GL_REPEAT, bool stream = false, int mipFlags = 0)
+    {
+        if (wrap == GL_REPEAT)
+            mipFlags |= MIPMAP_WRAP;
+        std::string canonical = canonicalPath(path);
+        std::string key = canonical + (gamma ? "|srgb|" : "|linear|") + std::to_string(wrap) + "|" + std::to_string(mipFlags);
+
+        auto it = byKey.find(key);
+        if (it != byKey.end())
+        {
+            hitCount++;
+            it->second.refCount++;
+            return it->second.id;
+        }
+
+        missCount++;
+        unsigned int id;
+        if (stream)
+            id = TextureStreamer::instance().load(canonical);
+        else
+        {
+            size_t slash = canonical.find_last_of('/');
+            std::string directory = slash == std::string::npos ? "." : canonical.substr(0, slash);
+            id = TextureFromFile(canonical.c_str() + (slash == std::string::npos ? 0 : slash + 1), directory, gamma, mipFlags);
+        }
+        glBindTexture(GL_TEXTURE_2D, id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+
+        byKey[key] = { id, 1, stream };
+        keyOf[id] = key;
+        return id;
+    }
+
+    // takes another reference on a texture handed out by acquire(). Returns the id, or 0 if the texture didn't
+    // come from the registry (nothing to reference count).
+    unsigned int retain(unsigned int id)
+    {
+        auto keyIt = keyOf.find(id);
+        if (keyIt == keyOf.end())
+            return 0;
+        byKey[keyIt->second].refCount++;
+        return id;
+    }
+
+    // drops one reference, deleting the texture when it was the last one.
+    // returns false if the texture didn't come from the registry.
+    bool release(unsigned int id)
+    {
+        auto keyIt = keyOf.find(id);
+        if (keyIt == keyOf.end())
+            return false;
+        auto it = byKey.find(keyIt->second);
+        if (--it->second.refCount == 0)
+        {
+            // the streamer would otherwise still upload into the deleted name
+            if (it->second.streamed)
+                TextureStreamer::instance().cancel(id);
+            glDeleteTextures(1, &id);
+            byKey.erase(it);
+            keyOf.erase(keyIt);
+        }
+        return true;
+    }
+
+    size_t hits() const { return hitCount; }
+    size_t misses() const { return missCount; }
+    size_t size() const { return byKey.size(); }
+
+    // unifies separators and resolves "." and ".." segments, so different spellings of a path share one entry
+    static std::string canonicalPath(std::string path)
+    {
+        std::replace(path.begin(), path.end(), '\\', '/');
+        bool absolute = !path.empty() && path[0] == '/';
+
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while (start <= path.size())
+        {
+            size_t end = path.find('/', start);
+            if (end == std::string::npos)
+                end = path.size();
+            std::string part = path.substr(start, end - start);
+            if (part == "..")
+            {
+                if (!parts.empty() && parts.back() != "..")
+                    parts.pop_back();
+                else if (!absolute)
+                    parts.push_back(part);
+            }
+            else if (!part.empty() && part != ".")
+                parts.push_back(part);
+            start = end + 1;
+        }
+
+        std::string result = absolute ? "/" : "";
+        for (size_t i = 0; i < parts.size(); i++)
+        {
+            if (i > 0)
+                result += '/';
+            result += parts[i];
+        }
+#ifdef _WIN32
+        // file names are case insensitive on windows
+        std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+#endif
+        return result;
+    }
+
+private:
+    struct Entry {
+        unsigned int id;
+        unsigned int refCount;
+        bool streamed;
+    };
+
+    std::unordered_map<std::string, Entry> byKey;
+    std::unordered_map<unsigned int, std::string> keyOf;
+    size_t hitCount = 0;
+    size_t missCount = 0;
+};
+#endif
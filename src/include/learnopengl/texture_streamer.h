@@ -0,0 +1,292 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <string>
+#include <iostream>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+
+// Streams textures in the background: images are decoded on a pool of worker threads while the caller
+// immediately gets a texture id holding a 1x1 placeholder. Once per frame update() copies decoded pixels
+// into a pixel unpack buffer (PBO), at most byteBudget bytes per call, and when an image is complete its
+// texture is specified from the PBO, so the driver can do the actual transfer asynchronously.
+// The budget only covers the copy into the PBO: the glTexImage2D from the PBO and the glGenerateMipmap of a
+// completed image are issued in the same update() regardless of its size, so a large texture still costs the
+// driver/GPU a full-size upload and mip build in the frame it completes.
+// load(), update() and cancel() must be called on the thread owning the GL context.
+class TextureStreamer
+{
+public:
+    // process-wide streamer
+    static TextureStreamer &instance()
+    {
+        static TextureStreamer streamer;
+        return streamer;
+    }
+
+    explicit TextureStreamer(unsigned int threadCount = 0) : stopping(false), pbo(0), active(false), copied(0)
+    {
+        if (threadCount == 0)
+        {
+            // leave one core for the render thread
+            unsigned int cores = std::thread::hardware_concurrency();
+            threadCount = cores > 1 ? cores - 1 : 1;
+        }
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back(&TextureStreamer::decodeLoop, this);
+    }
+
+    // only stops the workers and frees pending pixel data; no GL calls here because the context may be gone already
+    ~TextureStreamer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (std::thread &t : workers)
+            t.join();
+        for (DecodedImage &image : decoded)
+            stbi_image_free(image.pixels);
+        if (active)
+            stbi_image_free(current.pixels);
+    }
+
+    TextureStreamer(const TextureStreamer &) = delete;
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    // creates the texture with a placeholder and queues the file for decoding. Returns the final texture id.
+    unsigned int load(const std::string &filename)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+
+        const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            unsigned long long serial = ++nextSerial;
+            live[textureID] = serial;
+            jobs.push_back({ textureID, serial, filename });
+            outstanding++;
+        }
+        wakeup.notify_one();
+        return textureID;
+    }
+
+    // uploads decoded images, spending at most byteBudget bytes of copying per call (but always making progress).
+    // call once per frame.
+    void update(size_t byteBudget = 4 * 1024 * 1024)
+    {
+        if (pbo == 0)
+            glGenBuffers(1, &pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+
+        size_t budget = (std::max)(byteBudget, (size_t)1);
+        while (budget > 0)
+        {
+            if (!active && !beginNext())
+                break;
+
+            size_t size = imageSize(current);
+            size_t chunk = (std::min)(budget, size - copied);
+            void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, copied, chunk, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            if (dst)
+            {
+                std::memcpy(dst, current.pixels + copied, chunk);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            }
+            copied += chunk;
+            budget -= chunk;
+
+            if (copied == size)
+                finishCurrent();
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // forgets a texture passed to load() that is about to be deleted, so its image is never uploaded into the dead
+    // (and possibly reused) name: drops the queued job or decoded image, or the upload in progress. A decode
+    // already running on a worker is discarded when it finishes. Does nothing for ids that aren't pending.
+    void cancel(unsigned int id)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = live.find(id);
+            if (it == live.end())
+                return;
+            live.erase(it);
+            outstanding--;
+            jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [id](const DecodeJob &job) { return job.id == id; }), jobs.end());
+            for (auto image = decoded.begin(); image != decoded.end();)
+            {
+                if (image->id == id)
+                {
+                    stbi_image_free(image->pixels);
+                    image = decoded.erase(image);
+                }
+                else
+                    ++image;
+            }
+        }
+        if (active && current.id == id)
+        {
+            stbi_image_free(current.pixels);
+            current.pixels = nullptr;
+            active = false;
+        }
+    }
+
+    // number of textures that still show their placeholder
+    size_t pending()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return outstanding;
+    }
+
+private:
+    struct DecodeJob {
+        unsigned int id;
+        unsigned long long serial;
+        std::string filename;
+    };
+
+    struct DecodedImage {
+        unsigned int id;
+        unsigned long long serial;
+        std::string filename;
+        unsigned char *pixels;
+        int width, height, components;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::deque<DecodeJob> jobs;
+    std::deque<DecodedImage> decoded;
+    size_t outstanding = 0;
+    // serial of the load() each pending texture id is waiting for; images of other serials were cancelled
+    std::unordered_map<unsigned int, unsigned long long> live;
+    unsigned long long nextSerial = 0;
+    bool stopping;
+
+    // upload state, only touched on the GL thread
+    unsigned int pbo;
+    bool active;
+    DecodedImage current;
+    size_t copied;
+
+    static size_t imageSize(const DecodedImage &image)
+    {
+        return (size_t)image.width * image.height * image.components;
+    }
+
+    // whether an image or job still belongs to a pending load(). Call with the mutex held.
+    bool isLive(unsigned int id, unsigned long long serial) const
+    {
+        auto it = live.find(id);
+        return it != live.end() && it->second == serial;
+    }
+
+    void decodeLoop()
+    {
+        for (;;)
+        {
+            DecodeJob job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeup.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping)
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            DecodedImage image;
+            image.id = job.id;
+            image.serial = job.serial;
+            image.filename = std::move(job.filename);
+            image.pixels = stbi_load(image.filename.c_str(), &image.width, &image.height, &image.components, 0);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (isLive(image.id, image.serial))
+                decoded.push_back(std::move(image));
+            else
+                stbi_image_free(image.pixels);
+        }
+    }
+
+    // picks the next decoded image and orphans the PBO storage for it. Returns false if nothing is ready.
+    bool beginNext()
+    {
+        for (;;)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (decoded.empty())
+                    return false;
+                current = std::move(decoded.front());
+                decoded.pop_front();
+                if (current.pixels)
+                    break;
+
+                // keep the placeholder for images that can't be loaded
+                live.erase(current.id);
+                outstanding--;
+            }
+            std::cout << "Texture failed to load at path: " << current.filename << std::endl;
+        }
+
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, imageSize(current), NULL, GL_STREAM_DRAW);
+        active = true;
+        copied = 0;
+        return true;
+    }
+
+    // specifies the texture from the filled PBO and builds its mipmaps
+    void finishCurrent()
+    {
+        GLenum format = GL_RGBA;
+        if (current.components == 1)
+            format = GL_RED;
+        else if (current.components == 2)
+            format = GL_RG;
+        else if (current.components == 3)
+            format = GL_RGB;
+
+        GLint alignment;
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rows of 1 and 3 channel images aren't 4 byte aligned
+
+        glBindTexture(GL_TEXTURE_2D, current.id);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, current.width, current.height, 0, format, GL_UNSIGNED_BYTE, (void *)0);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+
+        stbi_image_free(current.pixels);
+        current.pixels = nullptr;
+        active = false;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        live.erase(current.id);
+        outstanding--;
+    }
+};
+#endif
@@ -0,0 +1,100 @@
+#ifndef UNIFORM_CACHE_H
+#define UNIFORM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <iostream>
+#include <unordered_map>
+
+// 32 bit FNV-1a, constexpr so literal uniform names are hashed by the compiler.
+// seed allows continuing a hash, UniformHash("b", UniformHash("a")) == UniformHash("ab").
+constexpr uint32_t UniformHash(const char *name, uint32_t seed = 2166136261u)
+{
+    uint32_t hash = seed;
+    for (; *name; ++name)
+        hash = (hash ^ (uint32_t)(unsigned char)*name) * 16777619u;
+    return hash;
+}
+
+// pre-hashed uniform name. Built implicitly from literals and strings, use the _u literal
+// (or a constexpr UniformName) to guarantee the hash is computed at compile time.
+struct UniformName {
+    uint32_t hash;
+    constexpr UniformName(const char *name) : hash(UniformHash(name)) {}
+    UniformName(const std::string &name) : hash(UniformHash(name.c_str())) {}
+    constexpr explicit UniformName(uint32_t hash) : hash(hash) {}
+};
+
+constexpr UniformName operator"" _u(const char *name, size_t)
+{
+    return UniformName(UniformHash(name));
+}
+
+// location table of all active uniforms of a program, filled once after linking
+class UniformCache
+{
+public:
+    void build(GLuint program)
+    {
+        locations.clear();
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        std::string name(maxLength > 0 ? maxLength : 1, '\0');
+        std::unordered_map<uint32_t, std::string> names;
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(program, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+            std::string uniform(name.c_str(), length);
+            // uniform blocks members have no location
+            if (glGetUniformLocation(program, uniform.c_str()) < 0)
+                continue;
+
+            // arrays of basic types are reported once as "name[0]", register the plain name and every element.
+            // (members of struct arrays are reported one by one and handled by the else branch)
+            if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+            {
+                std::string base = uniform.substr(0, uniform.size() - 3);
+                add(program, base, names);
+                for (GLint e = 0; e < size; e++)
+                {
+                    std::string element = base + "[" + std::to_string(e) + "]";
+                    add(program, element, names);
+                }
+            }
+            else
+                add(program, uniform, names);
+        }
+    }
+
+    // -1 for names that aren't active, glUniform* ignores that location
+    GLint operator[](UniformName name) const
+    {
+        auto it = locations.find(name.hash);
+        return it != locations.end() ? it->second : -1;
+    }
+
+private:
+    std::unordered_map<uint32_t, GLint> locations;
+
+    void add(GLuint program, const std::string &key, std::unordered_map<uint32_t, std::string> &names)
+    {
+        uint32_t hash = UniformHash(key.c_str());
+        auto known = names.find(hash);
+        if (known != names.end())
+        {
+            if (known->second != key)
+                std::cout << "WARNING::SHADER::UNIFORM_HASH_COLLISION " << known->second << " / " << key << std::endl;
+            return;
+        }
+        names[hash] = key;
+        locations[hash] = glGetUniformLocation(program, key.c_str());
+    }
+};
+#endif
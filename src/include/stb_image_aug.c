@@ -78,6 +78,20 @@
 #include <assert.h>
 #include <stdarg.h>
 
+#if STBI_SIMD && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+   // the slot for other instruction sets (NEON) is next to every STBI_SSE2 block below
+   #define STBI_SSE2
+   #include <emmintrin.h>
+#endif
+
+#if STBI_SIMD
+   #ifdef _MSC_VER
+      #define STBI_ALIGN16 __declspec(align(16))
+   #else
+      #define STBI_ALIGN16 __attribute__((aligned(16)))
+   #endif
+#endif
+
 #ifndef _MSC_VER
   #ifdef __cplusplus
   #define __forceinline inline
@@ -976,7 +990,178 @@ static void idct_block(uint8 *out, int out_stride, short data[64], unsigned shor
       o[4] = clamp((x3-t0) >> 17);
    }
 }
+
+#ifdef STBI_SSE2
+// the same IDCT on 8 columns (then rows) at once in 16-bit lanes, widened to 32 bits where the constants multiply.
+// bit exact with idct_block as long as the dequantized coefficients and the column pass output fit in 16 bits.
+static void idct_block_sse2(uint8 *out, int out_stride, short data[64], unsigned short *dequantize)
+{
+   __m128i row0, row1, row2, row3, row4, row5, row6, row7;
+   __m128i tmp;
+
+   // dot product constant: even elems=x, odd elems=y
+   #define dct_const(x,y)  _mm_setr_epi16((short)(x),(short)(y),(short)(x),(short)(y),(short)(x),(short)(y),(short)(x),(short)(y))
+
+   // out0 = c0[even]*x + c0[odd]*y, out1 = c1[even]*x + c1[odd]*y   (x, y 16-bit, out 32-bit)
+   #define dct_rot(out0,out1, x,y,c0,c1) \
+      __m128i c0##lo = _mm_unpacklo_epi16((x),(y)); \
+      __m128i c0##hi = _mm_unpackhi_epi16((x),(y)); \
+      __m128i out0##_l = _mm_madd_epi16(c0##lo, c0); \
+      __m128i out0##_h = _mm_madd_epi16(c0##hi, c0); \
+      __m128i out1##_l = _mm_madd_epi16(c0##lo, c1); \
+      __m128i out1##_h = _mm_madd_epi16(c0##hi, c1)
+
+   // out = in << 12  (in 16-bit, out 32-bit)
+   #define dct_widen(out, in) \
+      __m128i out##_l = _mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), (in)), 4); \
+      __m128i out##_h = _mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), (in)), 4)
+
+   #define dct_wadd(out, a, b) \
+      __m128i out##_l = _mm_add_epi32(a##_l, b##_l); \
+      __m128i out##_h = _mm_add_epi32(a##_h, b##_h)
+
+   #define dct_wsub(out, a, b) \
+      __m128i out##_l = _mm_sub_epi32(a##_l, b##_l); \
+      __m128i out##_h = _mm_sub_epi32(a##_h, b##_h)
+
+   // butterfly a/b, add bias, then shift by "s" and pack back to 16 bits
+   #define dct_bfly32o(out0, out1, a,b,bias,s) \
+      { \
+         __m128i abiased_l = _mm_add_epi32(a##_l, bias); \
+         __m128i abiased_h = _mm_add_epi32(a##_h, bias); \
+         dct_wadd(sum, abiased, b); \
+         dct_wsub(dif, abiased, b); \
+         out0 = _mm_packs_epi32(_mm_srai_epi32(sum_l, s), _mm_srai_epi32(sum_h, s)); \
+         out1 = _mm_packs_epi32(_mm_srai_epi32(dif_l, s), _mm_srai_epi32(dif_h, s)); \
+      }
+
+   // interleave steps for the transposes
+   #define dct_interleave8(a, b) \
+      tmp = a; \
+      a = _mm_unpacklo_epi8(a, b); \
+      b = _mm_unpackhi_epi8(tmp, b)
+
+   #define dct_interleave16(a, b) \
+      tmp = a; \
+      a = _mm_unpacklo_epi16(a, b); \
+      b = _mm_unpackhi_epi16(tmp, b)
+
+   // IDCT_1D on 8 lanes; the rotations fold the shared products of IDCT_1D into one multiply pair each
+   #define dct_pass(bias,shift) \
+      { \
+         /* even part */ \
+         dct_rot(t2e,t3e, row2,row6, rot0_0,rot0_1); \
+         __m128i sum04 = _mm_add_epi16(row0, row4); \
+         __m128i dif04 = _mm_sub_epi16(row0, row4); \
+         dct_widen(t0e, sum04); \
+         dct_widen(t1e, dif04); \
+         dct_wadd(x0, t0e, t3e); \
+         dct_wsub(x3, t0e, t3e); \
+         dct_wadd(x1, t1e, t2e); \
+         dct_wsub(x2, t1e, t2e); \
+         /* odd part */ \
+         dct_rot(y0o,y2o, row7,row3, rot2_0,rot2_1); \
+         dct_rot(y1o,y3o, row5,row1, rot3_0,rot3_1); \
+         __m128i sum17 = _mm_add_epi16(row1, row7); \
+         __m128i sum35 = _mm_add_epi16(row3, row5); \
+         dct_rot(y4o,y5o, sum17,sum35, rot1_0,rot1_1); \
+         dct_wadd(x4, y0o, y4o); \
+         dct_wadd(x5, y1o, y5o); \
+         dct_wadd(x6, y2o, y5o); \
+         dct_wadd(x7, y3o, y4o); \
+         dct_bfly32o(row0,row7, x0,x7,bias,shift); \
+         dct_bfly32o(row1,row6, x1,x6,bias,shift); \
+         dct_bfly32o(row2,row5, x2,x5,bias,shift); \
+         dct_bfly32o(row3,row4, x3,x4,bias,shift); \
+      }
+
+   __m128i rot0_0 = dct_const(f2f(0.5411961f), f2f(0.5411961f) + f2f(-1.847759065f));
+   __m128i rot0_1 = dct_const(f2f(0.5411961f) + f2f( 0.765366865f), f2f(0.5411961f));
+   __m128i rot1_0 = dct_const(f2f(1.175875602f) + f2f(-0.899976223f), f2f(1.175875602f));
+   __m128i rot1_1 = dct_const(f2f(1.175875602f), f2f(1.175875602f) + f2f(-2.562915447f));
+   __m128i rot2_0 = dct_const(f2f(-1.961570560f) + f2f( 0.298631336f), f2f(-1.961570560f));
+   __m128i rot2_1 = dct_const(f2f(-1.961570560f), f2f(-1.961570560f) + f2f( 3.072711026f));
+   __m128i rot3_0 = dct_const(f2f(-0.390180644f) + f2f( 2.053119869f), f2f(-0.390180644f));
+   __m128i rot3_1 = dct_const(f2f(-0.390180644f), f2f(-0.390180644f) + f2f( 1.501321110f));
+
+   // rounding biases of the two passes as in idct_block; the second one also folds in clamp()'s +128
+   __m128i bias_0 = _mm_set1_epi32(512);
+   __m128i bias_1 = _mm_set1_epi32(65536 + (128<<17));
+
+   // load and dequantize
+   row0 = _mm_mullo_epi16(_mm_loadu_si128((const __m128i *) (data + 0*8)), _mm_loadu_si128((const __m128i *) (dequantize + 0*8)));
+   row1 = _mm_mullo_epi16(_mm_loadu_si128((const __m128i *) (data + 1*8)), _mm_loadu_si128((const __m128i *) (dequantize + 1*8)));
+   row2 = _mm_mullo_epi16(_mm_loadu_si128((const __m128i *) (data + 2*8)), _mm_loadu_si128((const __m128i *) (dequantize + 2*8)));
+   row3 = _mm_mullo_epi16(_mm_loadu_si128((const __m128i *) (data + 3*8)), _mm_loadu_si128((const __m128i *) (dequantize + 3*8)));
+   row4 = _mm_mullo_epi16(_mm_loadu_si128((const __m128i *) (data + 4*8)), _mm_loadu_si128((const __m128i *) (dequantize + 4*8)));
+   row5 = _mm_mullo_epi16(_mm_loadu_si128((const __m128i *) (data + 5*8)), _mm_loadu_si128((const __m128i *) (dequantize + 5*8)));
+   row6 = _mm_mullo_epi16(_mm_loadu_si128((const __m128i *) (data + 6*8)), _mm_loadu_si128((const __m128i *) (dequantize + 6*8)));
+   row7 = _mm_mullo_epi16(_mm_loadu_si128((const __m128i *) (data + 7*8)), _mm_loadu_si128((const __m128i *) (dequantize + 7*8)));
+
+   // column pass
+   dct_pass(bias_0, 10);
+
+   {
+      // 16bit 8x8 transpose
+      dct_interleave16(row0, row4);
+      dct_interleave16(row1, row5);
+      dct_interleave16(row2, row6);
+      dct_interleave16(row3, row7);
+
+      dct_interleave16(row0, row2);
+      dct_interleave16(row1, row3);
+      dct_interleave16(row4, row6);
+      dct_interleave16(row5, row7);
+
+      dct_interleave16(row0, row1);
+      dct_interleave16(row2, row3);
+      dct_interleave16(row4, row5);
+      dct_interleave16(row6, row7);
+   }
+
+   // row pass
+   dct_pass(bias_1, 17);
+
+   {
+      // pack with unsigned saturation (the clamp), then 8bit 8x8 transpose
+      __m128i p0 = _mm_packus_epi16(row0, row1); // a0a1a2a3...a7b0b1b2b3...b7
+      __m128i p1 = _mm_packus_epi16(row2, row3);
+      __m128i p2 = _mm_packus_epi16(row4, row5);
+      __m128i p3 = _mm_packus_epi16(row6, row7);
+
+      dct_interleave8(p0, p2); // a0e0a1e1...
+      dct_interleave8(p1, p3); // c0g0c1g1...
+
+      dct_interleave8(p0, p1); // a0c0e0g0...
+      dct_interleave8(p2, p3); // b0d0f0h0...
+
+      dct_interleave8(p0, p2); // a0b0c0d0...
+      dct_interleave8(p1, p3); // a4b4c4d4...
+
+      _mm_storel_epi64((__m128i *) out, p0); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p0, 0x4e)); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, p2); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p2, 0x4e)); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, p1); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p1, 0x4e)); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, p3); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p3, 0x4e));
+   }
+
+   #undef dct_const
+   #undef dct_rot
+   #undef dct_widen
+   #undef dct_wadd
+   #undef dct_wsub
+   #undef dct_bfly32o
+   #undef dct_interleave8
+   #undef dct_interleave16
+   #undef dct_pass
+}
+static stbi_idct_8x8 stbi_idct_installed = idct_block_sse2;
+#else
 static stbi_idct_8x8 stbi_idct_installed = idct_block;
+#endif
 
 extern void stbi_install_idct(stbi_idct_8x8 func)
 {
@@ -1023,7 +1208,7 @@ static int parse_entropy_coded_data(jpeg *z)
    if (z->scan_n == 1) {
       int i,j;
       #if STBI_SIMD
-      __declspec(align(16))
+      STBI_ALIGN16
       #endif
       short data[64];
       int n = z->order[0];
@@ -1053,6 +1238,9 @@ static int parse_entropy_coded_data(jpeg *z)
       }
    } else { // interleaved!
       int i,j,k,x,y;
+      #if STBI_SIMD
+      STBI_ALIGN16
+      #endif
       short data[64];
       for (j=0; j < z->img_mcu_y; ++j) {
          for (i=0; i < z->img_mcu_x; ++i) {
@@ -1116,7 +1304,7 @@ static int process_marker(jpeg *z, int m)
                z->dequant[t][dezigzag[i]] = get8u(&z->s);
             #if STBI_SIMD
             for (i=0; i < 64; ++i)
-               z->dequant2[t][i] = dequant[t][i];
+               z->dequant2[t][i] = z->dequant[t][i];
             #endif
             L -= 65;
          }
@@ -1382,7 +1570,7 @@ static uint8 *resample_row_generic(uint8 *out, uint8 *in_near, uint8 *in_far, in
 
 // 0.38 seconds on 3*anemones.jpg   (0.25 with processor = Pro)
 // VC6 without processor=Pro is generating multiple LEAs per multiply!
-static void YCbCr_to_RGB_row(uint8 *out, uint8 *y, uint8 *pcb, uint8 *pcr, int count, int step)
+static void YCbCr_to_RGB_row(uint8 *out, uint8 const *y, uint8 const *pcb, uint8 const *pcr, int count, int step)
 {
    int i;
    for (i=0; i < count; ++i) {
@@ -1408,7 +1596,75 @@ static void YCbCr_to_RGB_row(uint8 *out, uint8 *y, uint8 *pcb, uint8 *pcr, int c
 }
 
 #if STBI_SIMD
+#ifdef STBI_SSE2
+// 8 pixels at a time in 32-bit lanes, same fixed point as YCbCr_to_RGB_row: the constants that don't fit in 16 bits
+// are split into a shift and a 16-bit multiply, 1.402 = 1 + 26345/65536, 0.71414 = 1 - 18734/65536, 1.772 = 2 - 14942/65536
+static void YCbCr_to_RGB_sse2(uint8 *out, uint8 const *y, uint8 const *pcb, uint8 const *pcr, int count, int step)
+{
+   int i = 0, k;
+   __m128i zero = _mm_setzero_si128();
+   __m128i bias = _mm_set1_epi16(128);
+   __m128i round = _mm_set1_epi32(32768);
+   __m128i alpha = _mm_set1_epi16(255);
+   // madd factors for interleaved (cr,cb) pairs
+   __m128i mul_r = _mm_setr_epi16(float2fixed(1.40200f) - 65536, 0, float2fixed(1.40200f) - 65536, 0,
+                                  float2fixed(1.40200f) - 65536, 0, float2fixed(1.40200f) - 65536, 0);
+   __m128i mul_g = _mm_setr_epi16(65536 - float2fixed(0.71414f), -float2fixed(0.34414f), 65536 - float2fixed(0.71414f), -float2fixed(0.34414f),
+                                  65536 - float2fixed(0.71414f), -float2fixed(0.34414f), 65536 - float2fixed(0.71414f), -float2fixed(0.34414f));
+   __m128i mul_b = _mm_setr_epi16(0, float2fixed(1.77200f) - 131072, 0, float2fixed(1.77200f) - 131072,
+                                  0, float2fixed(1.77200f) - 131072, 0, float2fixed(1.77200f) - 131072);
+   STBI_ALIGN16 uint8 rgba[32];
+
+   #define ycc_half(unpack, r, g, b) \
+      { \
+         __m128i y32  = unpack(y16, zero); \
+         __m128i cr32 = _mm_srai_epi32(unpack(cr16, cr16), 16); \
+         __m128i cb32 = _mm_srai_epi32(unpack(cb16, cb16), 16); \
+         __m128i crcb = unpack(cr16, cb16); \
+         r = _mm_add_epi32(_mm_slli_epi32(_mm_add_epi32(y32, cr32), 16), _mm_add_epi32(round, _mm_madd_epi16(crcb, mul_r))); \
+         g = _mm_add_epi32(_mm_slli_epi32(_mm_sub_epi32(y32, cr32), 16), _mm_add_epi32(round, _mm_madd_epi16(crcb, mul_g))); \
+         b = _mm_add_epi32(_mm_slli_epi32(_mm_add_epi32(y32, _mm_add_epi32(cb32, cb32)), 16), _mm_add_epi32(round, _mm_madd_epi16(crcb, mul_b))); \
+         r = _mm_srai_epi32(r, 16); \
+         g = _mm_srai_epi32(g, 16); \
+         b = _mm_srai_epi32(b, 16); \
+      }
+
+   for (; i + 8 <= count; i += 8) {
+      __m128i y16  = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (y + i)), zero);
+      __m128i cb16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (pcb + i)), zero), bias);
+      __m128i cr16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (pcr + i)), zero), bias);
+      __m128i r_l, g_l, b_l, r_h, g_h, b_h;
+      __m128i rg, ba, rgx, bax;
+      ycc_half(_mm_unpacklo_epi16, r_l, g_l, b_l)
+      ycc_half(_mm_unpackhi_epi16, r_h, g_h, b_h)
+      // saturating packs do the clamp to 0..255
+      rg = _mm_packus_epi16(_mm_packs_epi32(r_l, r_h), _mm_packs_epi32(g_l, g_h));   // r0..r7 g0..g7
+      ba = _mm_packus_epi16(_mm_packs_epi32(b_l, b_h), alpha);                        // b0..b7 255..255
+      rgx = _mm_unpacklo_epi8(rg, _mm_srli_si128(rg, 8));                            // r0 g0 r1 g1 ...
+      bax = _mm_unpacklo_epi8(ba, _mm_srli_si128(ba, 8));                            // b0 a0 b1 a1 ...
+      if (step == 4) {
+         _mm_storeu_si128((__m128i *) out, _mm_unpacklo_epi16(rgx, bax));
+         _mm_storeu_si128((__m128i *) (out + 16), _mm_unpackhi_epi16(rgx, bax));
+         out += 32;
+      } else {
+         _mm_store_si128((__m128i *) rgba, _mm_unpacklo_epi16(rgx, bax));
+         _mm_store_si128((__m128i *) (rgba + 16), _mm_unpackhi_epi16(rgx, bax));
+         for (k=0; k < 8; ++k) {
+            out[0] = rgba[k*4+0];
+            out[1] = rgba[k*4+1];
+            out[2] = rgba[k*4+2];
+            out[3] = 255; // like YCbCr_to_RGB_row, the next pixel overwrites it
+            out += step;
+         }
+      }
+   }
+   #undef ycc_half
+   YCbCr_to_RGB_row(out, y + i, pcb + i, pcr + i, count - i, step);
+}
+static stbi_YCbCr_to_RGB_run stbi_YCbCr_installed = YCbCr_to_RGB_sse2;
+#else
 static stbi_YCbCr_to_RGB_run stbi_YCbCr_installed = YCbCr_to_RGB_row;
+#endif
 
 void stbi_install_YCbCr_to_RGB(stbi_YCbCr_to_RGB_run func)
 {
@@ -1416,6 +1672,80 @@ void stbi_install_YCbCr_to_RGB(stbi_YCbCr_to_RGB_run func)
 }
 #endif
 
+#if STBI_SIMD
+#ifdef STBI_SSE2
+// resample_row_hv_2 on 8 input samples (16 output) at a time; the last sample of the row goes through the scalar
+// code since the filter needs the sample after it
+static uint8 *resample_row_hv_2_sse2(uint8 *out, uint8 *in_near, uint8 *in_far, int w, int hs)
+{
+   int i=0,t0,t1;
+   if (w == 1) {
+      out[0] = out[1] = div4(3*in_near[0] + in_far[0] + 2);
+      return out;
+   }
+
+   t1 = 3*in_near[0] + in_far[0];
+   for (; i < ((w-1) & ~7); i += 8) {
+      // vertical pass: 3*near + far = 4*near + (far - near)
+      __m128i zero  = _mm_setzero_si128();
+      __m128i farw  = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (in_far + i)), zero);
+      __m128i nearw = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (in_near + i)), zero);
+      __m128i curr  = _mm_add_epi16(_mm_slli_epi16(nearw, 2), _mm_sub_epi16(farw, nearw));
+
+      // neighbours: shifted by one sample, the missing ones from the previous and next group
+      __m128i prev = _mm_insert_epi16(_mm_slli_si128(curr, 2), t1, 0);
+      __m128i next = _mm_insert_epi16(_mm_srli_si128(curr, 2), 3*in_near[i+8] + in_far[i+8], 7);
+
+      // horizontal pass: even = 3*cur + prev + 8, odd = 3*cur + next + 8, then >> 4
+      __m128i curb = _mm_add_epi16(_mm_slli_epi16(curr, 2), _mm_set1_epi16(8));
+      __m128i even = _mm_add_epi16(_mm_sub_epi16(prev, curr), curb);
+      __m128i odd  = _mm_add_epi16(_mm_sub_epi16(next, curr), curb);
+      __m128i de0  = _mm_srli_epi16(_mm_unpacklo_epi16(even, odd), 4);
+      __m128i de1  = _mm_srli_epi16(_mm_unpackhi_epi16(even, odd), 4);
+      _mm_storeu_si128((__m128i *) (out + i*2), _mm_packus_epi16(de0, de1));
+
+      t1 = 3*in_near[i+7] + in_far[i+7];
+   }
+
+   t0 = t1;
+   t1 = 3*in_near[i] + in_far[i];
+   out[i*2] = div16(3*t1 + t0 + 8);
+   for (++i; i < w; ++i) {
+      t0 = t1;
+      t1 = 3*in_near[i]+in_far[i];
+      out[i*2-1] = div16(3*t0 + t1 + 8);
+      out[i*2  ] = div16(3*t1 + t0 + 8);
+   }
+   out[w*2-1] = div4(t1+2);
+   return out;
+}
+static stbi_resample_row_hv_2 stbi_resample_hv_2_installed = resample_row_hv_2_sse2;
+#else
+static stbi_resample_row_hv_2 stbi_resample_hv_2_installed = resample_row_hv_2;
+#endif
+
+void stbi_install_resample_row_hv_2(stbi_resample_row_hv_2 func)
+{
+   stbi_resample_hv_2_installed = func;
+}
+
+int stbi_install_jpeg_simd(int simd)
+{
+   #ifdef STBI_SSE2
+   if (simd) {
+      stbi_idct_installed = idct_block_sse2;
+      stbi_YCbCr_installed = YCbCr_to_RGB_sse2;
+      stbi_resample_hv_2_installed = resample_row_hv_2_sse2;
+      return 1;
+   }
+   #endif
+   stbi_idct_installed = idct_block;
+   stbi_YCbCr_installed = YCbCr_to_RGB_row;
+   stbi_resample_hv_2_installed = resample_row_hv_2;
+   return 0;
+}
+#endif
+
 
 // clean up the temporary component buffers
 static void cleanup_jpeg(jpeg *j)
@@ -1488,7 +1818,11 @@ static uint8 *load_jpeg_image(jpeg *z, int *out_x, int *out_y, int *comp, int re
          if      (r->hs == 1 && r->vs == 1) r->resample = resample_row_1;
          else if (r->hs == 1 && r->vs == 2) r->resample = resample_row_v_2;
          else if (r->hs == 2 && r->vs == 1) r->resample = resample_row_h_2;
+         #if STBI_SIMD
+         else if (r->hs == 2 && r->vs == 2) r->resample = stbi_resample_hv_2_installed;
+         #else
          else if (r->hs == 2 && r->vs == 2) r->resample = resample_row_hv_2;
+         #endif
          else                               r->resample = resample_row_generic;
       }
 
@@ -326,22 +326,40 @@ typedef struct
 extern int stbi_register_loader(stbi_loader *loader);
 
 // define faster low-level operations (typically SIMD support)
+// on by default when the compiler targets SSE2, which installs the SSE2 versions below
+#ifndef STBI_SIMD
+   #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+      #define STBI_SIMD 1
+   #endif
+#endif
 #if STBI_SIMD
-typedef void (*stbi_idct_8x8)(uint8 *out, int out_stride, short data[64], unsigned short *dequantize);
+typedef void (*stbi_idct_8x8)(stbi_uc *out, int out_stride, short data[64], unsigned short *dequantize);
 // compute an integer IDCT on "input"
 //     input[x] = data[x] * dequantize[x]
 //     write results to 'out': 64 samples, each run of 8 spaced by 'out_stride'
 //                             CLAMP results to 0..255
-typedef void (*stbi_YCbCr_to_RGB_run)(uint8 *output, uint8 const *y, uint8 const *cb, uint8 const *cr, int count, int step);
+typedef void (*stbi_YCbCr_to_RGB_run)(stbi_uc *output, stbi_uc const *y, stbi_uc const *cb, stbi_uc const *cr, int count, int step);
 // compute a conversion from YCbCr to RGB
 //     'count' pixels
 //     write pixels to 'output'; each pixel is 'step' bytes (either 3 or 4; if 4, write '255' as 4th), order R,G,B
 //     y: Y input channel
 //     cb: Cb input channel; scale/biased to be 0..255
 //     cr: Cr input channel; scale/biased to be 0..255
+typedef stbi_uc *(*stbi_resample_row_hv_2)(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs);
+// upsample one row of a chroma channel subsampled 2x2 ("fancy", triangle filter)
+//     'w' input samples, 2*w written to 'out'
+//     in_near: nearest input row, in_far: the row on the other side; weighted 3:1
+//     return the row to use, 'out'
 
 extern void stbi_install_idct(stbi_idct_8x8 func);
 extern void stbi_install_YCbCr_to_RGB(stbi_YCbCr_to_RGB_run func);
+extern void stbi_install_resample_row_hv_2(stbi_resample_row_hv_2 func);
+
+// install the built-in implementations of all three: the SIMD ones (SSE2, when the compiler targets it) if 'simd',
+// otherwise the plain C ones. The SIMD ones are installed by default and produce the exact same pixels (for
+// dequantized coefficients that fit in 16 bits, which holds for any valid baseline JPEG).
+// returns 1 if SIMD versions were installed
+extern int stbi_install_jpeg_simd(int simd);
 #endif // STBI_SIMD
 
 #ifdef __cplusplus
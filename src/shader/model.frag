@@ -0,0 +1,15 @@
+#version 330 core
+// diffuse texture with a fixed directional light, enough to see a Model drawn through Mesh::Draw
+out vec4 FragColor;
+
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform sampler2D texture_diffuse1;
+
+void main()
+{
+    vec3 color = texture(texture_diffuse1, TexCoords).rgb;
+    float diffuse = max(dot(normalize(Normal), normalize(vec3(0.3, 0.5, 1.0))), 0.0);
+    FragColor = vec4(color * (0.2 + 0.8 * diffuse), 1.0);
+}
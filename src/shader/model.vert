@@ -0,0 +1,20 @@
+#version 330 core
+// vertex shader for Model/Mesh with the default VERTEX_FLOAT layout (see Vertex in learnopengl/mesh.h)
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 Normal;
+out vec2 TexCoords;
+
+uniform mat4 model;
+uniform mat3 normalMatrix;  // transpose(inverse(mat3(model))), computed once per draw on the CPU
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    Normal = normalMatrix * aNormal;
+    TexCoords = aTexCoords;
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,36 @@
+#version 330 core
+// vertex shader for meshes uploaded with VERTEX_PACKED (see PackedVertex in learnopengl/mesh.h)
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aNormal;      // octahedral
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec4 aTangent;     // octahedral xy, bitangent sign in w
+
+out vec3 FragPos;
+out vec2 TexCoords;
+out mat3 TBN;
+
+uniform mat4 model;
+uniform mat3 normalMatrix;  // transpose(inverse(mat3(model))), computed once per draw on the CPU
+uniform mat4 view;
+uniform mat4 projection;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    vec3 N = normalize(normalMatrix * octDecode(aNormal));
+    vec3 T = normalize(normalMatrix * octDecode(aTangent.xy));
+    vec3 B = cross(N, T) * (aTangent.w < 0.0 ? -1.0 : 1.0);
+    TBN = mat3(T, B, N);
+
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    TexCoords = aTexCoords;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -3,8 +3,29 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
 #include <stb_image.h>
+#include <image_DXT.h>
+#include <image_helper.h>
+#include <learnopengl/profiler.h>
+// --benchmark ʱͳÿ֡Ķѷ滻ȫ operator new/deleteֻһ뵥Ԫﶨ壩
+#define BENCHMARK_COUNT_ALLOCATIONS
+#include <learnopengl/benchmark.h>
+#include <learnopengl/clustered_lighting.h>
+#include <learnopengl/gbuffer.h>
+#include <learnopengl/ibl.h>
+#include <learnopengl/orm_texture.h>
+#include <learnopengl/mip_cache.h>
+#include <learnopengl/model.h>
+#include <memory>
 
 const char* vertexShaderSource = R"glsl(
 #version 330 core
@@ -17,35 +38,49 @@ out vec3 Normal;
 out vec2 TexCoords;
 
 uniform mat4 model;
+uniform mat3 normalMatrix;  // transpose(inverse(mat3(model)))ÿλCPUһ
 uniform mat4 view;
 uniform mat4 projection;
 
 void main() {
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = normalMatrix * aNormal;
     TexCoords = aTexCoords;
     gl_Position = projection * view * model * vec4(aPos, 1.0);
 }
 )glsl";
 
-const char* fragmentShaderSource = R"glsl(
-#version 330 core
-out vec4 FragColor;
-
-in vec3 FragPos;
-in vec3 Normal;
-in vec2 TexCoords;
-
-uniform sampler2D texture_diffuse1;
-uniform float metallic;
-uniform float roughness;
-uniform float ao;
-
-uniform vec3 lightPositions[4];
-uniform vec3 lightColors[4];
+// ǰӳ·õPBRմ룬 withPbrLighting() 嵽 #version ֮
+const char* pbrLightingShaderSource = R"glsl(
+// ִعգÿ(Ļ x Ƭ)ֻཻĹԴ LightClusters ÿ֡д
+uniform samplerBuffer lightData;      // ÿԴtexelλ+뾶ɫ
+uniform usamplerBuffer clusterData;   // ÿأԴʼλã
+uniform usamplerBuffer lightIndices;
+uniform ivec3 clusterTiles;
+uniform vec2 clusterTileSize;
+uniform float clusterScale;
+uniform float clusterBias;
+uniform float clusterNear;
+uniform float clusterFar;
+
+// ͼĻգ IBL  newport_loft.hdr Ԥ(ӻ)
+uniform samplerCube irradianceMap;
+uniform samplerCube prefilterMap;
+uniform sampler2D brdfLUT;
+uniform float prefilterMaxLod;
 
 const float PI = 3.14159265359;
 
+uvec2 fragmentCluster(vec2 fragCoord, float fragDepth) {
+    // ȻֵԭΪ۲ռȣֲٰƬ
+    float ndcZ = fragDepth * 2.0 - 1.0;
+    float depth = 2.0 * clusterNear * clusterFar / (clusterFar + clusterNear - ndcZ * (clusterFar - clusterNear));
+    int slice = clamp(int(floor(log(depth) * clusterScale + clusterBias)), 0, clusterTiles.z - 1);
+    ivec2 tile = min(ivec2(fragCoord / clusterTileSize), clusterTiles.xy - 1);
+    int index = tile.x + tile.y * clusterTiles.x + slice * clusterTiles.x * clusterTiles.y;
+    return texelFetch(clusterData, index).xy;
+}
+
 float DistributionGGX(vec3 N, vec3 H, float roughness) {
     float a = roughness * roughness;
     float a2 = a * a;
@@ -82,22 +117,32 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0) {
     return F0 + (1.0 - F0) * pow(1.0 - cosTheta, 5.0);
 }
 
-void main() {
-    vec3 N = normalize(Normal);
-    vec3 V = normalize(-FragPos);
+vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness) {
+    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(1.0 - cosTheta, 5.0);
+}
 
-    vec3 albedo = texture(texture_diffuse1, TexCoords).rgb;
+// ƬڴйԴ Cook-Torrance գϻⲢɫӳGammaУ
+vec3 shadePbr(vec3 N, vec3 V, vec3 P, vec2 fragCoord, float fragDepth, vec3 albedo, float metallic, float roughness, float ao) {
     vec3 F0 = vec3(0.04);
     F0 = mix(F0, albedo, metallic);
 
     vec3 Lo = vec3(0.0);
-    for (int i = 0; i < 4; ++i) {
-        vec3 L = normalize(lightPositions[i] - FragPos);
+    uvec2 cluster = fragmentCluster(fragCoord, fragDepth);
+    for (uint i = 0u; i < cluster.y; ++i) {
+        int light = int(texelFetch(lightIndices, int(cluster.x + i)).r);
+        vec4 positionRadius = texelFetch(lightData, light * 2);
+        vec3 lightColor = texelFetch(lightData, light * 2 + 1).rgb;
+
+        float distance = length(positionRadius.xyz - P);
+        if (distance >= positionRadius.w)
+            continue;
+        vec3 L = normalize(positionRadius.xyz - P);
         vec3 H = normalize(V + L);
 
-        float distance = length(lightPositions[i] - FragPos);
-        float attenuation = 1.0 / (distance * distance);
-        vec3 radiance = lightColors[i] * attenuation;
+        // ƽ˥ԴںڹԴ뾶ƽ˥0
+        float window = clamp(1.0 - pow(distance / positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (distance * distance);
+        vec3 radiance = lightColor * attenuation;
 
         float NDF = DistributionGGX(N, H, roughness);
         float G = GeometrySmith(N, V, L, roughness);
@@ -115,13 +160,127 @@ void main() {
         Lo += (kD * albedo / PI + specular) * radiance * NdotL;
     }
 
-    vec3 ambient = vec3(0.03) * albedo * ao;
+    // ⣺ȡնͼ淴Ԥ˲ͼBRDFұ(split sum)
+    float NdotV = max(dot(N, V), 0.0);
+    vec3 F = fresnelSchlickRoughness(NdotV, F0, roughness);
+    vec3 kD = (1.0 - F) * (1.0 - metallic);
+    vec3 diffuse = texture(irradianceMap, N).rgb * albedo;
+    vec3 prefiltered = textureLod(prefilterMap, reflect(-V, N), roughness * prefilterMaxLod).rgb;
+    vec2 brdf = texture(brdfLUT, vec2(NdotV, roughness)).rg;
+    vec3 specular = prefiltered * (F * brdf.x + brdf.y);
+    vec3 ambient = (kD * diffuse + specular) * ao;
     vec3 color = ambient + Lo;
 
     // HDR  Gamma У
     color = color / (color + vec3(1.0));
-    color = pow(color, vec3(1.0 / 2.2));
+    return pow(color, vec3(1.0 / 2.2));
+}
+)glsl";
+
+// ǰȾÿͨȲԵƬζһ
+const char* fragmentShaderSource = R"glsl(
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform sampler2D texture_diffuse1;
+uniform float metallic;
+uniform float roughness;
+uniform float ao;
+// ORMͼr = ao, g = roughness, b = metallicһβͼ
+uniform sampler2D ormMap;
+uniform bool useOrmMap;
+uniform vec3 camPos;  // ռλ
 
+void main() {
+    vec3 N = normalize(Normal);
+    vec3 V = normalize(camPos - FragPos);
+    vec3 albedo = texture(texture_diffuse1, TexCoords).rgb;
+    vec3 orm = useOrmMap ? texture(ormMap, TexCoords).rgb : vec3(ao, roughness, metallic);
+    vec3 color = shadePbr(N, V, FragPos, gl_FragCoord.xy, gl_FragCoord.z, albedo, orm.b, orm.g, orm.r);
+    FragColor = vec4(color, 1.0);
+}
+)glsl";
+
+// ӳȾһֻѲʺͷдG-bufferּ learnopengl/gbuffer.h
+const char* gbufferFragmentShaderSource = R"glsl(
+#version 330 core
+layout (location = 0) out vec4 gMaterial;  // albedo.rgb, metallic
+layout (location = 1) out vec4 gNormal;    // ķ.xy, roughness, ao
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform sampler2D texture_diffuse1;
+uniform float metallic;
+uniform float roughness;
+uniform float ao;
+uniform sampler2D ormMap;  // r = ao, g = roughness, b = metallic
+uniform bool useOrmMap;
+
+// λͶӰչΣܴ
+vec2 octEncode(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.xy * 0.5 + 0.5;
+}
+
+void main() {
+    vec3 orm = useOrmMap ? texture(ormMap, TexCoords).rgb : vec3(ao, roughness, metallic);
+    gMaterial = vec4(texture(texture_diffuse1, TexCoords).rgb, orm.b);
+    gNormal = vec4(octEncode(normalize(Normal)), orm.g, orm.r);
+}
+)glsl";
+
+// ӳȾڶȫΣÿֻǰıһι
+const char* fullscreenVertexShaderSource = R"glsl(
+#version 330 core
+void main() {
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)glsl";
+
+const char* deferredLightingFragmentShaderSource = R"glsl(
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D gMaterial;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+uniform vec3 camPos;  // ռλ
+
+vec3 octDecode(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth == 1.0)
+        discard;  // ɫ
+
+    // ؽռλ
+    vec2 ndc = gl_FragCoord.xy / vec2(textureSize(gDepth, 0)) * 2.0 - 1.0;
+    vec4 position = inverseViewProjection * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+    vec3 P = position.xyz / position.w;
+
+    vec4 material = texelFetch(gMaterial, pixel, 0);
+    vec4 normal = texelFetch(gNormal, pixel, 0);
+    vec3 N = octDecode(normal.xy);
+    vec3 V = normalize(camPos - P);
+    vec3 color = shadePbr(N, V, P, gl_FragCoord.xy, depth, material.rgb, material.a, normal.z, normal.w);
     FragColor = vec4(color, 1.0);
 }
 )glsl";
@@ -137,31 +296,19 @@ unsigned int loadTexture(const char* path) {
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
 
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-	if (data) {
-		GLenum format = GL_RGB; // Ĭֵֹδʼ
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
+	// ɫͼmipmapԿռKaiser˲һк󻺴浽 <ļ>.mips
+	MipChain chain;
+	if (chain.load(path, MIPMAP_SRGB | MIPMAP_WRAP)) {
 		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		chain.upload();
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
 	}
 	else {
 		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
 	}
 
 	return textureID;
@@ -217,12 +364,206 @@ unsigned int createShaderProgram(const char* vertexShaderSource, const char* fra
 	return shaderProgram;
 }
 
-int main() {
+// ѹPBRմ뵽Ƭɫ #version ֮
+std::string withPbrLighting(const char* source) {
+	std::string result = source;
+	size_t line = result.find('\n', result.find("#version"));
+	result.insert(line + 1, pbrLightingShaderSource);
+	return result;
+}
+
+// --dxt[=Ŀ¼]ıοʵֺSIMD+߳ʵֱַ pbr Ŀ¼µͼѹDXT1/DXT5
+// MPix/sֽڱȽߵٰͼ;ѹ BC7(albedo)/BC5(normal)/BC4()
+//  RGBA8 ĴСȻ˳ڣвһʱ1
+int runDxtBenchmark(const std::string& directory) {
+	typedef unsigned char* (*DxtEncoder)(const unsigned char* const, int, int, int, int*);
+	const char* materials[] = { "gold", "grass", "plastic", "rusted_iron", "wall" };
+	const char* maps[] = { "albedo", "normal", "metallic", "roughness", "ao" };
+	const char* formats[] = { "DXT1", "DXT5" };
+	DxtEncoder reference[] = { convert_image_to_DXT1_reference, convert_image_to_DXT5_reference };
+	DxtEncoder fast[] = { convert_image_to_DXT1, convert_image_to_DXT5 };
+	double pixels = 0.0, referenceSeconds[2] = { 0.0, 0.0 }, fastSeconds[2] = { 0.0, 0.0 };
+	int mismatches = 0;
+
+	for (const char* material : materials) {
+		for (const char* map : maps) {
+			std::string path = directory + "/" + material + "/" + map + ".png";
+			int width, height, channels;
+			unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+			if (!data)
+				continue;
+			double mpix = width * (double)height / 1.0e6;
+			pixels += mpix;
+			std::cout << material << "/" << map << " " << width << "x" << height << "x" << channels;
+			for (int f = 0; f < 2; f++) {
+				int referenceSize, fastSize;
+				auto start = std::chrono::steady_clock::now();
+				unsigned char* expected = reference[f](data, width, height, channels, &referenceSize);
+				auto middle = std::chrono::steady_clock::now();
+				unsigned char* actual = fast[f](data, width, height, channels, &fastSize);
+				auto end = std::chrono::steady_clock::now();
+				double referenceTime = std::chrono::duration<double>(middle - start).count();
+				double fastTime = std::chrono::duration<double>(end - middle).count();
+				referenceSeconds[f] += referenceTime;
+				fastSeconds[f] += fastTime;
+				bool same = referenceSize == fastSize && std::memcmp(expected, actual, referenceSize) == 0;
+				mismatches += same ? 0 : 1;
+				std::cout << "  " << formats[f] << " ο: " << mpix / referenceTime << " : " << mpix / fastTime
+					<< " MPix/s" << (same ? "" : " һ!");
+				std::free(expected);
+				std::free(actual);
+			}
+
+			//  SOIL_FLAG_ALBEDO_MAP / SOIL_FLAG_NORMAL_MAP / SOIL_FLAG_SCALAR_MAP ѡĸʽһ
+			std::string role = map;
+			const char* roleFormat = role == "albedo" ? "BC7" : role == "normal" ? "BC5" : "BC4";
+			DxtEncoder roleEncoder = role == "albedo" ? convert_image_to_BC7 : role == "normal" ? convert_image_to_BC5 : convert_image_to_BC4;
+			int roleSize;
+			auto roleStart = std::chrono::steady_clock::now();
+			unsigned char* roleData = roleEncoder(data, width, height, channels, &roleSize);
+			double roleTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - roleStart).count();
+			std::cout << "  " << roleFormat << ": " << mpix / roleTime << " MPix/s С: " << roleSize / 1024
+				<< " KB (RGBA8  1/" << width * height * 4 / (std::max)(roleSize, 1) << ")";
+			std::free(roleData);
+			std::cout << std::endl;
+			stbi_image_free(data);
+		}
+	}
+	if (pixels == 0.0) {
+		std::cout << "ERROR::DXT:: " << directory << " ûҵͼ" << std::endl;
+		return 1;
+	}
+	for (int f = 0; f < 2; f++)
+		std::cout << formats[f] << " ϼ " << pixels << " MPix ο: " << pixels / referenceSeconds[f]
+			<< " : " << pixels / fastSeconds[f] << " MPix/s" << std::endl;
+	std::cout << (mismatches ? "οʵֲһµ" : "οʵһ") << std::endl;
+	return mismatches ? 1 : 0;
+}
+
+//  level ͨ 0.5 alphaԵرûalphaͨͼƬ
+static float alphaCoverage(const unsigned char* chain, int width, int height, int channels, int level) {
+	for (int i = 0; i < level; i++) {
+		chain += width * height * channels;
+		width = (std::max)(width / 2, 1);
+		height = (std::max)(height / 2, 1);
+	}
+	int alpha = channels == 2 || channels == 4 ? channels - 1 : 0, covered = 0;
+	for (int i = 0; i < width * height; i++)
+		covered += chain[i * channels + alpha] > 127 ? 1 : 0;
+	return covered / (float)(width * height);
+}
+
+// --mipmaps[=Ŀ¼] mipmap_imagegammaռĺʽ˲ build_mipmap_chainԿռKaiser˲SIMDʹCںˣ
+//  nanosuit ͼmipmapMPix/sֽڱȽSIMDʹC
+//  cell_*_alpha ڵ08x8ͨalphaԵıȻ˳ڣвһʱ1
+int runMipmapBenchmark(const std::string& directory) {
+	const char* files[] = { "arm_dif.png", "body_dif.png", "arm_showroom_ddn.png", "cell_arm_alpha.png", "cell_body_alpha.png" };
+	int mismatches = 0;
+	double pixels = 0.0, boxSeconds = 0.0, simdSeconds = 0.0, scalarSeconds = 0.0;
+	for (const char* file : files) {
+		int width, height, channels;
+		unsigned char* data = stbi_load((directory + "/" + file).c_str(), &width, &height, &channels, 0);
+		if (!data)
+			continue;
+		std::string name = file;
+		int flags = MIPMAP_WRAP | (name.find("_alpha") != std::string::npos ? MIPMAP_ALPHA_COVERAGE :
+			name.find("_ddn") != std::string::npos ? MIPMAP_NORMAL_MAP : MIPMAP_SRGB);
+		int levels = mipmap_chain_levels(width, height);
+		std::vector<unsigned char> box(mipmap_chain_size(width, height, channels)), simd(box.size()), scalar(box.size());
+		std::memcpy(box.data(), data, width * height * channels);
+
+		// ԭ SOIL ÿһӵ0ƽ
+		auto start = std::chrono::steady_clock::now();
+		unsigned char* level = box.data() + width * height * channels;
+		for (int i = 1, w = width, h = height; i < levels; i++) {
+			w = (std::max)(w / 2, 1);
+			h = (std::max)(h / 2, 1);
+			mipmap_image(data, width, height, channels, level, 1 << i, 1 << i);
+			level += w * h * channels;
+		}
+		auto middle = std::chrono::steady_clock::now();
+		build_mipmap_chain(data, width, height, channels, MIPMAP_FILTER_KAISER, flags, simd.data());
+		auto end = std::chrono::steady_clock::now();
+		build_mipmap_chain(data, width, height, channels, MIPMAP_FILTER_KAISER, flags | MIPMAP_NO_SIMD, scalar.data());
+		auto last = std::chrono::steady_clock::now();
+
+		double mpix = width * (double)height / 1.0e6;
+		double boxTime = std::chrono::duration<double>(middle - start).count();
+		double simdTime = std::chrono::duration<double>(end - middle).count();
+		double scalarTime = std::chrono::duration<double>(last - end).count();
+		pixels += mpix;
+		boxSeconds += boxTime;
+		simdSeconds += simdTime;
+		scalarSeconds += scalarTime;
+		bool same = simd == scalar;
+		mismatches += same ? 0 : 1;
+		std::cout << file << " " << width << "x" << height << "x" << channels << "  mipmap_image: " << mpix / boxTime
+			<< "  Kaiser SIMD: " << mpix / simdTime << "  C: " << mpix / scalarTime << " MPix/s" << (same ? "" : " һ!");
+		if (flags & MIPMAP_ALPHA_COVERAGE) {
+			int level8 = (std::max)(levels - 4, 0);
+			std::cout << "  alphaԸ 0: " << alphaCoverage(simd.data(), width, height, channels, 0)
+				<< " 8x8: ʽ " << alphaCoverage(box.data(), width, height, channels, level8)
+				<< " ָ " << alphaCoverage(simd.data(), width, height, channels, level8);
+		}
+		std::cout << std::endl;
+		stbi_image_free(data);
+	}
+	if (pixels == 0.0) {
+		std::cout << "ERROR::MIPMAP:: " << directory << " ûҵͼ" << std::endl;
+		return 1;
+	}
+	std::cout << "ϼ " << pixels << " MPix mipmap_image: " << pixels / boxSeconds << " Kaiser SIMD: " << pixels / simdSeconds
+		<< " C: " << pixels / scalarSeconds << " MPix/s" << std::endl;
+	std::cout << (mismatches ? "SIMD봿Cһ" : "SIMD봿Cһ") << std::endl;
+	return mismatches ? 1 : 0;
+}
+
+// --ormcheck[=Ŀ¼] pbr Ŀ¼ÿʵ ao/roughness/metallic ORMͼдԵ orm.cache
+// ٰѻĵ0뵥ԭͼرȽϣȻ˳ڣвһʱ1
+int runOrmCheck(const std::string& directory) {
+	const char* materials[] = { "gold", "grass", "plastic", "rusted_iron", "wall" };
+	int failures = 0;
+	for (const char* material : materials) {
+		std::string materialDir = directory + "/" + material;
+		std::vector<unsigned char> cache;
+		if (!OrmTexture::Cook(materialDir, cache)) {
+			failures++;
+			continue;
+		}
+		long long mismatches = OrmTexture::Verify(materialDir);
+		if (mismatches < 0)
+			std::cout << material << " Ч" << std::endl;
+		else
+			std::cout << material << " һµ: " << mismatches << std::endl;
+		failures += mismatches == 0 ? 0 : 1;
+	}
+	std::cout << (failures ? "ORMͼԭͼһ" : "ORMͼԭͼһ") << std::endl;
+	return failures ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+	// --benchmarkشڡرմ̶ֱͬʱ䲽Ⱦ̶֡ͳƲ˳
+	BenchmarkOptions benchmark = ParseBenchmarkOptions(argc, argv);
+	if (benchmark.flag("dxt")) {
+		std::string directory = benchmark.params["dxt"];
+		return runDxtBenchmark(directory.empty() ? "D:/Visual Studio/Project/GLstudy/src/source/textures/pbr" : directory);
+	}
+	if (benchmark.flag("mipmaps")) {
+		std::string directory = benchmark.params["mipmaps"];
+		return runMipmapBenchmark(directory.empty() ? "D:/Visual Studio/Project/GLstudy/src/source/objects/nanosuit" : directory);
+	}
+	if (benchmark.flag("ormcheck")) {
+		std::string directory = benchmark.params["ormcheck"];
+		return runOrmCheck(directory.empty() ? "D:/Visual Studio/Project/GLstudy/src/source/textures/pbr" : directory);
+	}
+
 	// ʼ GLFW
+	ApplyBenchmarkInitHints(benchmark);
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	ApplyBenchmarkWindowHints(benchmark);
 
 	// 
 	GLFWwindow* window = glfwCreateWindow(800, 600, "PBR Triangle", NULL, NULL);
@@ -239,6 +580,11 @@ int main() {
 		return -1;
 	}
 
+	BenchmarkRun benchmarkRun(benchmark);
+	BenchmarkCapture benchmarkCapture;
+	if (benchmark.enabled)
+		glfwSwapInterval(0);
+
 	// ӿ
 	glViewport(0, 0, 800, 600);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
@@ -247,7 +593,18 @@ int main() {
 	glEnable(GL_DEPTH_TEST);
 
 	// ɫ
-	unsigned int shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
+	// --deferred ʹӳȾдG-bufferȫpassÿֻһι
+	bool deferred = benchmark.flag("deferred");
+	unsigned int shaderProgram = createShaderProgram(vertexShaderSource, withPbrLighting(fragmentShaderSource).c_str());
+	unsigned int gbufferProgram = createShaderProgram(vertexShaderSource, gbufferFragmentShaderSource);
+	unsigned int lightingProgram = createShaderProgram(fullscreenVertexShaderSource, withPbrLighting(deferredLightingFragmentShaderSource).c_str());
+	glUseProgram(lightingProgram);
+	glUniform1i(glGetUniformLocation(lightingProgram, "gMaterial"), 0);
+	glUniform1i(glGetUniformLocation(lightingProgram, "gNormal"), 1);
+	glUniform1i(glGetUniformLocation(lightingProgram, "gDepth"), 2);
+	GBuffer gbuffer;
+	unsigned int fullscreenVAO;  // ȫεĶ gl_VertexID ɣcore profile һVAO
+	glGenVertexArrays(1, &fullscreenVAO);
 
 	// ö
 	unsigned int VAO, VBO;
@@ -279,38 +636,93 @@ int main() {
 	float metallic = 0.1f;    // שǷǽ
 	float roughness = 0.7f;   // שϴֲ
 	float ao = 1.0f;
+	// --material=  pbr/ µͼ albedo.png ʱ滻ao/roughness/metallic һORMͼ
+	// һдд orm.cacheֱ֮Ӷ
+	OrmTexture ormTexture;
+	std::string material = benchmark.params["material"];
+	if (!material.empty()) {
+		std::string materialDir = "D:/Visual Studio/Project/GLstudy/src/source/textures/pbr/" + material;
+		if (std::ifstream(materialDir + "/albedo.png")) {
+			glDeleteTextures(1, &brickTexture);
+			brickTexture = loadTexture((materialDir + "/albedo.png").c_str());
+		}
+		ormTexture.load(materialDir);
+	}
 
 	// ùԴ - ǿͻϸ
-	glm::vec3 lightPositions[] = {
-		glm::vec3(-1.0f, 1.0f, 2.0f),
-		glm::vec3(1.0f, 1.0f, 2.0f),
-		glm::vec3(-1.0f, -1.0f, 2.0f),
-		glm::vec3(1.0f, -1.0f, 2.0f)
-	};
-
-	glm::vec3 lightColors[] = {
-		glm::vec3(400.0f, 400.0f, 400.0f),
-		glm::vec3(400.0f, 400.0f, 400.0f),
-		glm::vec3(400.0f, 400.0f, 400.0f),
-		glm::vec3(400.0f, 400.0f, 400.0f)
-	};
+	// --lights=N NСԴ(λù̶ͬпɱȽ)ڲԷִعԴĿ
+	int lightCount = benchmark.intParam("lights", 4);
+	std::vector<PointLight> lights;
+	if (lightCount == 4) {
+		glm::vec3 lightPositions[] = {
+			glm::vec3(-1.0f, 1.0f, 2.0f),
+			glm::vec3(1.0f, 1.0f, 2.0f),
+			glm::vec3(-1.0f, -1.0f, 2.0f),
+			glm::vec3(1.0f, -1.0f, 2.0f)
+		};
+		for (const glm::vec3& position : lightPositions) {
+			PointLight light;
+			light.position = position;
+			light.color = glm::vec3(400.0f, 400.0f, 400.0f);
+			light.radius = PointLightRadius(light.color);
+			lights.push_back(light);
+		}
+	}
+	else {
+		unsigned int seed = 12345u;
+		auto random = [&seed]() {
+			seed = seed * 1664525u + 1013904223u;
+			return (seed >> 8) / 16777216.0f;
+		};
+		for (int i = 0; i < lightCount; i++) {
+			PointLight light;
+			light.position = glm::vec3(random() * 2.4f - 1.2f, random() * 1.8f - 0.9f, 0.1f + random() * 0.9f);
+			light.color = glm::vec3(0.5f + random(), 0.5f + random(), 0.5f + random()) * 0.5f;
+			light.radius = 0.35f;
+			lights.push_back(light);
+		}
+	}
+	LightClusters clusters;
+
+	// գһԤ㲢д newport_loft.hdr.iblֱ֮Ӷ
+	IBL ibl;
+	ibl.load("D:/Visual Studio/Project/GLstudy/src/source/textures/hdr/newport_loft.hdr");
+
+	// ¼ÿ֡ƺͽCPU/GPUʱ䣬ÿڿ̨
+	// --trace[=ļ]ǰ600֡дChrome traceĬ test_trace.json
+	Profiler profiler;
+	if (benchmark.flag("trace")) {
+		std::string tracePath = benchmark.params["trace"];
+		profiler.startTrace(tracePath.empty() ? "test_trace.json" : tracePath, 600);
+	}
+	double reportTime = glfwGetTime();
+
+	// --layers=N δӺǰN㣬overdrawȽǰӳȾ
+	int layerCount = (std::max)(1, benchmark.intParam("layers", 1));
+
+	// --model[=·]ǰ Model::Draw һģ(Ĭ nanosuit)--benchmark ʱͳÿ֡Ķѷ
+	std::unique_ptr<Model> drawModel;
+	std::unique_ptr<Shader> modelShader;
+	if (benchmark.flag("model")) {
+		std::string modelPath = benchmark.params["model"];
+		drawModel.reset(new Model(modelPath.empty() ? "D:/Visual Studio/Project/GLstudy/src/source/objects/nanosuit/nanosuit.obj" : modelPath));
+		modelShader.reset(new Shader("D:/Visual Studio/Project/GLstudy/src/shader/model.vert", "D:/Visual Studio/Project/GLstudy/src/shader/model.frag"));
+	}
 
 	// ѭ
 	while (!glfwWindowShouldClose(window)) {
-		// 
-		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		// ʹɫ
-		glUseProgram(shaderProgram);
+		profiler.beginFrame();
+		int drawScope = profiler.begin("draw");
 
 		// ģ;
 		glm::mat4 model = glm::mat4(1.0f);
-		model = glm::rotate(model, (float)glfwGetTime() * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+		float time = benchmark.enabled ? (float)benchmarkRun.time() : (float)glfwGetTime();
+		model = glm::rotate(model, time * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
 
 		// ͼ
+		glm::vec3 cameraPosition(0.0f, 0.0f, 3.0f);
 		glm::mat4 view = glm::lookAt(
-			glm::vec3(0.0f, 0.0f, 3.0f), // λ
+			cameraPosition,              // λ
 			glm::vec3(0.0f, 0.0f, 0.0f), // Ŀλ
 			glm::vec3(0.0f, 1.0f, 0.0f)  // 
 		);
@@ -323,37 +735,145 @@ int main() {
 			100.0f              // Զƽ
 		);
 
+		// Դִأ·
+		int framebufferWidth, framebufferHeight;
+		glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+		clusters.build(lights, view, glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+
+		// ǰȾֱӻĻӳȾȻG-buffer
+		// شڵĬ֡δģ׼Եһ֡Լ֡ٶ
+		bool captureFrame = benchmark.enabled && benchmarkRun.lastFrame();
+		GLuint outputFramebuffer = benchmarkCapture.target(captureFrame, framebufferWidth, framebufferHeight);
+		if (deferred) {
+			gbuffer.resize(framebufferWidth, framebufferHeight);
+			glBindFramebuffer(GL_FRAMEBUFFER, gbuffer.fbo);
+		}
+		else
+			glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+		int geometryScope = profiler.begin("geometry");
+
+		// 
+		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// ʹɫ
+		unsigned int program = deferred ? gbufferProgram : shaderProgram;
+		glUseProgram(program);
+
 		// ݾɫ
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+		glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+		glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+		// ߾ֻģ;йأCPUһΣÿ4x4
+		glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(model));
+		glUniformMatrix3fv(glGetUniformLocation(program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(normalMatrix));
 
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, brickTexture);
-		glUniform1i(glGetUniformLocation(shaderProgram, "texture_diffuse1"), 0);
+		glUniform1i(glGetUniformLocation(program, "texture_diffuse1"), 0);
 
 		// PBRʲ
-		glUniform1f(glGetUniformLocation(shaderProgram, "metallic"), metallic);
-		glUniform1f(glGetUniformLocation(shaderProgram, "roughness"), roughness);
-		glUniform1f(glGetUniformLocation(shaderProgram, "ao"), ao);
-
-		// ݹԴ
-		glUniform3fv(glGetUniformLocation(shaderProgram, "lightPositions"), 4, glm::value_ptr(lightPositions[0]));
-		glUniform3fv(glGetUniformLocation(shaderProgram, "lightColors"), 4, glm::value_ptr(lightColors[0]));
-
-		// Ⱦ
+		glUniform1f(glGetUniformLocation(program, "metallic"), metallic);
+		glUniform1f(glGetUniformLocation(program, "roughness"), roughness);
+		glUniform1f(glGetUniformLocation(program, "ao"), ao);
+		glUniform1i(glGetUniformLocation(program, "useOrmMap"), ormTexture.texture != 0);
+
+		// ǰȾĹԴ󶨵Ԫ1-34-6ORMͼ7G-buffer׶ORMͼ1
+		if (!deferred) {
+			glUniform3fv(glGetUniformLocation(program, "camPos"), 1, glm::value_ptr(cameraPosition));
+			clusters.bind(program, 1, framebufferWidth, framebufferHeight);
+			ibl.bind(program, 4);
+		}
+		if (ormTexture.texture)
+			ormTexture.bind(program, deferred ? 1 : 7);
+
+		// ȾΣʱԶһ㻭ÿ㶼ͨȲ
 		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, 3);
+		for (int layer = layerCount - 1; layer >= 0; layer--) {
+			glm::mat4 layerModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -0.02f * layer)) * model;
+			glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(layerModel));
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+		}
+		profiler.end(geometryScope);
+
+		// ӳٹգG-bufferԪ0-2Դ3-56-8
+		if (deferred) {
+			int lightingScope = profiler.begin("lighting");
+			glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glDisable(GL_DEPTH_TEST);
+			glUseProgram(lightingProgram);
+			gbuffer.bindTextures(0);
+			glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+			glUniformMatrix4fv(glGetUniformLocation(lightingProgram, "inverseViewProjection"), 1, GL_FALSE, glm::value_ptr(inverseViewProjection));
+			glUniform3fv(glGetUniformLocation(lightingProgram, "camPos"), 1, glm::value_ptr(cameraPosition));
+			clusters.bind(lightingProgram, 3, framebufferWidth, framebufferHeight);
+			ibl.bind(lightingProgram, 6);
+			glBindVertexArray(fullscreenVAO);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+			glEnable(GL_DEPTH_TEST);
+			profiler.end(lightingScope);
+		}
+
+		if (drawModel) {
+			int modelScope = profiler.begin("model");
+			glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.8f, 0.5f));
+			modelMatrix = glm::scale(glm::rotate(modelMatrix, time * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(0.1f));
+			modelShader->use();
+			modelShader->setMat4("model", modelMatrix);
+			modelShader->setMat3("normalMatrix", glm::inverseTranspose(glm::mat3(modelMatrix)));
+			modelShader->setMat4("view", view);
+			modelShader->setMat4("projection", projection);
+			uint64_t allocationsBefore = AllocationCount();
+			drawModel->Draw(*modelShader);
+			benchmarkRun.countAllocations("Model::Draw", AllocationCount() - allocationsBefore);
+			profiler.end(modelScope);
+		}
+		profiler.end(drawScope);
+
+		// һ֡ڽǰأУȷϲͬȾһ
+		if (captureFrame)
+			benchmarkRun.setChecksum(benchmarkCapture.checksum());
 
 		// ¼
+		int swapScope = profiler.begin("swap");
 		glfwSwapBuffers(window);
+		profiler.end(swapScope);
 		glfwPollEvents();
+		profiler.endFrame();
+
+		if (benchmark.enabled) {
+			benchmarkRun.frameEnd();
+			if (benchmarkRun.finished())
+				break;
+		}
+
+		if (glfwGetTime() - reportTime >= 1.0) {
+			reportTime = glfwGetTime();
+			profiler.report();
+		}
 	}
+	profiler.stopTrace();
+	profiler.release();
+	clusters.release();
+	gbuffer.release();
+	benchmarkCapture.release();
+	ibl.release();
+	ormTexture.release();
+	// ģͺɫҪǰͷ
+	drawModel.reset();
+	modelShader.reset();
+
+	if (benchmark.enabled)
+		benchmarkRun.report(std::string(deferred ? "GLtest deferred" : "GLtest forward") + " lights=" + std::to_string(lights.size()) +
+			" layers=" + std::to_string(layerCount) + (drawModel ? " model" : ""), (const char*)glGetString(GL_RENDERER));
 
 	// Դ
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
+	glDeleteVertexArrays(1, &fullscreenVAO);
 	glDeleteProgram(shaderProgram);
+	glDeleteProgram(gbufferProgram);
+	glDeleteProgram(lightingProgram);
 	glfwTerminate();
 	return 0;
 }
\ No newline at end of file